@@ -0,0 +1,245 @@
+// Alert engine
+//
+// Threshold, percentage-move and rate-of-change alert rules with hysteresis.
+// Rules are compiled once (grouped per instrument, units pre-scaled) and
+// evaluated incrementally on each price update of their instrument only.
+//
+// Version 1.2
+
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include <Arduino.h>
+#include "flasher.h"
+
+#define ALERT_MAX_INSTRUMENTS 8
+#define ALERT_MAX_RULES 16
+
+enum class AlertType
+{
+    Above,       // Price at or above value.
+    Below,       // Price at or below value.
+    PercentUp,   // Change from open at or above value percent.
+    PercentDown, // Change from open at or below minus value percent.
+    RateUp,      // Rise of at least value percent per minute.
+    RateDown     // Fall of at least value percent per minute.
+};
+
+struct AlertRule
+{
+    byte instrument;
+    AlertType type;
+    Pattern pattern;
+    float trigger; // Level at which the alert sets (pre-scaled).
+    float release; // Level at which the alert clears (pre-scaled).
+    bool active;
+};
+
+class alertEngine
+{
+
+private:
+    AlertRule _rules[ALERT_MAX_RULES];
+    byte _ruleCount = 0;
+
+    // Rules are kept grouped by instrument, [_first, _first + _count).
+    byte _first[ALERT_MAX_INSTRUMENTS] = {};
+    byte _count[ALERT_MAX_INSTRUMENTS] = {};
+
+    float _lastPrice[ALERT_MAX_INSTRUMENTS] = {};
+    uint32_t _lastMillis[ALERT_MAX_INSTRUMENTS] = {};
+
+    // Index of the active rule per instrument, -1 if none.
+    int8_t _activeRule[ALERT_MAX_INSTRUMENTS];
+
+    static bool isRising(AlertType type)
+    {
+        return type == AlertType::Above || type == AlertType::PercentUp || type == AlertType::RateUp;
+    }
+
+public:
+    // Default Constructor.
+    alertEngine()
+    {
+        clear();
+    }
+
+    inline void clear()
+    {
+        _ruleCount = 0;
+        for (int i = 0; i < ALERT_MAX_INSTRUMENTS; i++)
+        {
+            _first[i] = 0;
+            _count[i] = 0;
+            _lastPrice[i] = 0;
+            _lastMillis[i] = 0;
+            _activeRule[i] = -1;
+        }
+    }
+
+    // Compile a rule and insert it into its instrument group.
+    // Value and hysteresis are in price units for Above/Below, percent otherwise.
+    bool addRule(byte instrument, AlertType type, float value, float hysteresis, Pattern pattern)
+    {
+        if (_ruleCount >= ALERT_MAX_RULES || instrument >= ALERT_MAX_INSTRUMENTS || value == 0)
+        {
+            return false;
+        }
+
+        AlertRule rule;
+        rule.instrument = instrument;
+        rule.type = type;
+        rule.pattern = pattern;
+        rule.active = false;
+
+        hysteresis = fabs(hysteresis);
+
+        // Falling rules compare against negated levels so evaluation is a single >= test.
+        if (type == AlertType::Above)
+        {
+            rule.trigger = value;
+            rule.release = value - hysteresis;
+        }
+        else if (type == AlertType::Below)
+        {
+            rule.trigger = -value;
+            rule.release = -value - hysteresis;
+        }
+        else
+        {
+            rule.trigger = fabs(value) / 100.0;
+            rule.release = (fabs(value) - hysteresis) / 100.0;
+        }
+
+        // Shift later groups up by one to keep rules contiguous per instrument.
+        byte insertAt = _first[instrument] + _count[instrument];
+        if (_count[instrument] == 0)
+        {
+            insertAt = 0;
+            for (int i = 0; i < instrument; i++)
+            {
+                insertAt += _count[i];
+            }
+        }
+
+        for (int i = _ruleCount; i > insertAt; i--)
+        {
+            _rules[i] = _rules[i - 1];
+        }
+        _rules[insertAt] = rule;
+        _ruleCount++;
+
+        // A new group starts at the insert position, an existing group keeps its start.
+        if (_count[instrument] == 0)
+        {
+            _first[instrument] = insertAt;
+        }
+        _count[instrument]++;
+        for (int i = instrument + 1; i < ALERT_MAX_INSTRUMENTS; i++)
+        {
+            if (_count[i])
+            {
+                _first[i]++;
+            }
+        }
+
+        return true;
+    }
+
+    // Evaluate the rules of one instrument against a new price.
+    // Returns true if the active alert of the instrument changed.
+    bool update(byte instrument, float open, float close, uint32_t ms)
+    {
+        if (instrument >= ALERT_MAX_INSTRUMENTS || close <= 0)
+        {
+            return false;
+        }
+
+        float change = open > 0 ? (close - open) / open : 0;
+
+        float rate = 0;
+        float lastPrice = _lastPrice[instrument];
+        uint32_t elapsed = ms - _lastMillis[instrument];
+        if (lastPrice > 0 && elapsed > 0)
+        {
+            rate = ((close - lastPrice) / lastPrice) * (60000.0 / elapsed);
+        }
+        _lastPrice[instrument] = close;
+        _lastMillis[instrument] = ms;
+
+        int8_t previous = _activeRule[instrument];
+        _activeRule[instrument] = -1;
+
+        byte end = _first[instrument] + _count[instrument];
+        for (byte i = _first[instrument]; i < end; i++)
+        {
+            AlertRule &rule = _rules[i];
+            float level;
+
+            if (rule.type == AlertType::Above)
+            {
+                level = close;
+            }
+            else if (rule.type == AlertType::Below)
+            {
+                level = -close;
+            }
+            else if (rule.type == AlertType::PercentUp)
+            {
+                level = change;
+            }
+            else if (rule.type == AlertType::PercentDown)
+            {
+                level = -change;
+            }
+            else if (rule.type == AlertType::RateUp)
+            {
+                level = rate;
+            }
+            else
+            {
+                level = -rate;
+            }
+
+            if (level >= rule.trigger)
+            {
+                rule.active = true;
+            }
+            else if (level < rule.release)
+            {
+                rule.active = false;
+            }
+
+            // First active rule in configuration order wins.
+            if (rule.active && _activeRule[instrument] < 0)
+            {
+                _activeRule[instrument] = i;
+            }
+        }
+
+        return previous != _activeRule[instrument];
+    }
+
+    inline bool active(byte instrument)
+    {
+        return instrument < ALERT_MAX_INSTRUMENTS && _activeRule[instrument] >= 0;
+    }
+
+    // True if the active alert is for a rising price.
+    inline bool rising(byte instrument)
+    {
+        return active(instrument) && isRising(_rules[_activeRule[instrument]].type);
+    }
+
+    inline Pattern pattern(byte instrument)
+    {
+        return active(instrument) ? _rules[_activeRule[instrument]].pattern : Pattern::Solid;
+    }
+
+    inline byte ruleCount()
+    {
+        return _ruleCount;
+    }
+};
+
+#endif
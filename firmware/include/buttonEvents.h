@@ -0,0 +1,208 @@
+// Button events
+//
+// Interrupt driven push button. The GPIO interrupt timestamps every edge
+// into a small lock-free queue, the main loop debounces the edges and
+// turns them into press, long press and release events.
+//
+// Debouncing works on the edge timestamps, not on the pin level when the
+// loop gets around to it: an edge followed by a quiet gap of at least the
+// debounce time is a settled change, and its level follows from the edges
+// alternating. A whole press and release while the loop is blocked still
+// gives both events, in order, only delayed.
+//
+// Version 1.2
+
+#ifndef BUTTON_EVENTS_H
+#define BUTTON_EVENTS_H
+
+#include <Arduino.h>
+
+// Must be a power of two.
+#define BUTTON_EDGE_QUEUE_SIZE 16
+
+enum class ButtonEventType
+{
+    Press,
+    LongPress,
+    Release
+};
+
+struct ButtonEvent
+{
+    ButtonEventType type;
+    uint32_t micros; // Time of the first edge of the change.
+};
+
+class buttonEvents
+{
+
+private:
+    static inline buttonEvents *_instance = nullptr;
+
+    uint8_t _pin;
+    bool _activeLow;
+    uint32_t _debounceMicros;
+    uint32_t _longPressMicros;
+
+    // Written by the interrupt only.
+    volatile uint32_t _edgeMicros[BUTTON_EDGE_QUEUE_SIZE];
+    volatile uint8_t _edgeHead = 0;
+    volatile unsigned long _overflows = 0;
+    volatile uint32_t _overflowMicros; // Time of the last dropped edge.
+
+    // Read by the main loop only.
+    uint8_t _edgeTail = 0;
+    bool _level = false;    // Level after the last edge taken from the queue.
+    bool _pressed = false;  // Debounced state.
+    bool _bouncing = false; // Edges taken since the last settled change.
+    uint32_t _firstEdgeMicros;
+    uint32_t _pressMicros;
+    bool _longPressSent = false;
+    unsigned long _overflowsSeen = 0;
+
+    static void IRAM_ATTR isr()
+    {
+        buttonEvents *self = _instance;
+        uint8_t head = self->_edgeHead;
+        uint8_t next = (head + 1) & (BUTTON_EDGE_QUEUE_SIZE - 1);
+
+        // Drop the edge when full, the level is re-read once the pin is quiet.
+        if (next == self->_edgeTail)
+        {
+            self->_overflows = self->_overflows + 1;
+            self->_overflowMicros = micros();
+            return;
+        }
+
+        self->_edgeMicros[head] = micros();
+        self->_edgeHead = next;
+    }
+
+    inline bool readLevel()
+    {
+        return (digitalRead(_pin) == LOW) == _activeLow;
+    }
+
+    // Debounced state follows _level, the change started at _firstEdgeMicros.
+    bool change(ButtonEvent *event)
+    {
+        _pressed = _level;
+        event->micros = _firstEdgeMicros;
+
+        if (_pressed)
+        {
+            _pressMicros = _firstEdgeMicros;
+            _longPressSent = false;
+            event->type = ButtonEventType::Press;
+        }
+        else
+        {
+            event->type = ButtonEventType::Release;
+        }
+        return true;
+    }
+
+public:
+    // Constructor.
+    // Debounce and long press in milliseconds.
+    buttonEvents(uint8_t pin, uint32_t debounce, uint32_t longPress, bool activeLow = true)
+    {
+        _pin = pin;
+        _debounceMicros = debounce * 1000;
+        _longPressMicros = longPress * 1000;
+        _activeLow = activeLow;
+    }
+
+    // Only one instance may be attached.
+    void begin()
+    {
+        _instance = this;
+        pinMode(_pin, INPUT);
+        _level = _pressed = readLevel();
+        attachInterrupt(digitalPinToInterrupt(_pin), isr, CHANGE);
+    }
+
+    // Returns true and fills event while events are pending.
+    bool read(ButtonEvent *event)
+    {
+        uint32_t now = micros();
+
+        while (true)
+        {
+            uint8_t head = _edgeHead;
+            bool queued = _edgeTail != head;
+            uint32_t edge = queued ? _edgeMicros[_edgeTail] : now;
+
+            // Held for the long press time before the next edge.
+            if (_pressed && !_longPressSent && edge - _pressMicros >= _longPressMicros)
+            {
+                _longPressSent = true;
+                event->type = ButtonEventType::LongPress;
+                event->micros = _pressMicros + _longPressMicros;
+                return true;
+            }
+
+            if (!queued)
+            {
+                break;
+            }
+
+            // The quiet gap after this edge ends at the next edge, or is still running.
+            uint8_t next = (_edgeTail + 1) & (BUTTON_EDGE_QUEUE_SIZE - 1);
+            uint32_t gapEnd = next != head ? _edgeMicros[next] : now;
+            bool settled = gapEnd - edge >= _debounceMicros;
+
+            if (next == head && !settled)
+            {
+                break;
+            }
+
+            _edgeTail = next;
+            _level = !_level;
+
+            if (!_bouncing)
+            {
+                _bouncing = true;
+                _firstEdgeMicros = edge;
+            }
+
+            if (settled)
+            {
+                _bouncing = false;
+
+                if (_level != _pressed)
+                {
+                    return change(event);
+                }
+            }
+        }
+
+        // Dropped edges break the alternation, take the level once the pin is quiet.
+        if (_overflows != _overflowsSeen && _edgeTail == _edgeHead && now - _overflowMicros >= _debounceMicros)
+        {
+            _overflowsSeen = _overflows;
+            _bouncing = false;
+            _level = readLevel();
+
+            if (_level != _pressed)
+            {
+                _firstEdgeMicros = _overflowMicros;
+                return change(event);
+            }
+        }
+
+        return false;
+    }
+
+    inline bool pressed()
+    {
+        return _pressed;
+    }
+
+    inline unsigned long overflows()
+    {
+        return _overflows;
+    }
+};
+
+#endif
@@ -2,7 +2,11 @@
 // Crude LED flashing pattern generator.
 // Not intended for precise timer.
 //
-// Version 1.0
+// Patterns can be stripped at compile time by defining FLASHER_PATTERNS as a
+// bit mask of (1 << Pattern), e.g. -D FLASHER_PATTERNS=0x13 for Solid, OnOff
+// and Flash. Disabled patterns fall back to Solid.
+//
+// Version 1.2
 
 #ifndef FLASHER_H
 #define FLASHER_H
@@ -20,6 +24,10 @@ enum class Pattern
     RandomReverseFlash
 };
 
+#ifndef FLASHER_PATTERNS
+#define FLASHER_PATTERNS 0x7F
+#endif
+
 class flasher
 {
 
@@ -29,18 +37,23 @@ private:
     int _maxPwm;
     int _pwmValue = 0;
     bool _repeat = true;
-    float _microsPerStep;
-    unsigned long _oldMicros;
+    float _microsPerStep = 0;
+    uint32_t _oldMicros;
 
     byte sinIndex;
     bool toggle = false;
     bool _endOfCycle;
 
+    static constexpr bool enabled(Pattern pattern)
+    {
+        return FLASHER_PATTERNS & (1 << (int)pattern);
+    }
+
 public:
     // Default Constructor
     flasher()
     {
-        _pattern = Pattern::Sin;
+        _pattern = enabled(Pattern::Sin) ? Pattern::Sin : Pattern::Solid;
         _maxPwm = 255;
         _delay = 1000;
     }
@@ -49,7 +62,7 @@ public:
     // Delay in milliseconds
     flasher(Pattern pattern, int delay, int maxPwm)
     {
-        _pattern = pattern;
+        _pattern = enabled(pattern) ? pattern : Pattern::Solid;
         _maxPwm = maxPwm;
         _delay = delay;
     }
@@ -61,7 +74,7 @@ public:
 
     inline void setPattern(Pattern pattern)
     {
-        _pattern = pattern;
+        _pattern = enabled(pattern) ? pattern : Pattern::Solid;
     }
 
     inline void reset()
@@ -100,11 +113,12 @@ public:
             return 0;
         }
 
-        unsigned long curMicros = micros();
+        uint32_t curMicros = micros();
 
         if ((curMicros - _oldMicros) > _microsPerStep)
         {
-            int stepsPassed = (float)(curMicros - _oldMicros) / _microsPerStep;
+            // The first update has no step length yet.
+            int stepsPassed = _microsPerStep > 0 ? (float)(curMicros - _oldMicros) / _microsPerStep : 1;
 
             if (_pattern == Pattern::Solid)
             {
@@ -113,7 +127,7 @@ public:
                 _pwmValue = _maxPwm;
             }
 
-            if (_pattern == Pattern::RampUp)
+            if (enabled(Pattern::RampUp) && _pattern == Pattern::RampUp)
             {
                 _microsPerStep = 1.0 / (((float)_maxPwm / (float)_delay) / 1000.0);
                 _pwmValue += stepsPassed;
@@ -124,7 +138,7 @@ public:
                     _endOfCycle = true;
                 }
             }
-            else if (_pattern == Pattern::Sin)
+            else if (enabled(Pattern::Sin) && _pattern == Pattern::Sin)
             {
                 _microsPerStep = 1.0 / ((180.0 / (float)_delay) / 1000.0);
                 sinIndex += stepsPassed;
@@ -136,13 +150,13 @@ public:
 				// TODO: use sin look up table.
                 _pwmValue = _maxPwm * sin(radians(sinIndex));
             }
-            else if (_pattern == Pattern::OnOff)
+            else if (enabled(Pattern::OnOff) && _pattern == Pattern::OnOff)
             {
                 _microsPerStep = ((float)_delay / 2.0) * 1000.0;
                 toggle = !toggle;
                 _pwmValue = toggle ? _maxPwm : 0;
             }
-            else if (_pattern == Pattern::Flash)
+            else if (enabled(Pattern::Flash) && _pattern == Pattern::Flash)
             {
                 if (toggle)
                 {
@@ -156,7 +170,7 @@ public:
                 }
                 _pwmValue = toggle ? _maxPwm : 0;
             }
-            else if (_pattern == Pattern::RandomFlash)
+            else if (enabled(Pattern::RandomFlash) && _pattern == Pattern::RandomFlash)
             {
                 if (toggle)
                 {
@@ -171,7 +185,7 @@ public:
                 }
                 _pwmValue = toggle ? _maxPwm : 0;
             }
-            else if (_pattern == Pattern::RandomReverseFlash)
+            else if (enabled(Pattern::RandomReverseFlash) && _pattern == Pattern::RandomReverseFlash)
             {
                 if (toggle)
                 {
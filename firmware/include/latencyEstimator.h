@@ -0,0 +1,92 @@
+// Latency estimator
+//
+// Tracks recent fetch latency as an exponentially weighted moving average
+// plus the 95th percentile of the last samples, used to start fetches
+// early enough to complete before their deadline.
+//
+// Version 1.0
+
+#ifndef LATENCY_ESTIMATOR_H
+#define LATENCY_ESTIMATOR_H
+
+#include <Arduino.h>
+
+#define LATENCY_SAMPLES 20
+
+class latencyEstimator
+{
+
+private:
+    uint32_t _samples[LATENCY_SAMPLES];
+    uint8_t _sampleCount = 0;
+    uint8_t _next = 0;
+    uint32_t _ewmaScaled = 0; // Milliseconds << 3.
+    uint32_t _margin;
+    uint32_t _initial;
+
+public:
+    // Constructor.
+    // Initial is assumed until the first sample, margin is added to the lead time (milliseconds).
+    latencyEstimator(uint32_t initial, uint32_t margin)
+    {
+        _initial = initial;
+        _margin = margin;
+    }
+
+    void add(uint32_t latency)
+    {
+        if (_sampleCount == 0)
+        {
+            _ewmaScaled = latency << 3;
+        }
+        else
+        {
+            // alpha = 1/8
+            _ewmaScaled = _ewmaScaled - (_ewmaScaled >> 3) + latency;
+        }
+
+        _samples[_next] = latency;
+        _next = (_next + 1) % LATENCY_SAMPLES;
+        if (_sampleCount < LATENCY_SAMPLES)
+        {
+            _sampleCount++;
+        }
+    }
+
+    inline uint32_t mean()
+    {
+        return _sampleCount ? _ewmaScaled >> 3 : _initial;
+    }
+
+    uint32_t p95()
+    {
+        if (_sampleCount == 0)
+        {
+            return _initial;
+        }
+
+        // Insertion sort of a copy, at most LATENCY_SAMPLES entries.
+        uint32_t sorted[LATENCY_SAMPLES];
+        for (int i = 0; i < _sampleCount; i++)
+        {
+            uint32_t value = _samples[i];
+            int j = i;
+            while (j > 0 && sorted[j - 1] > value)
+            {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = value;
+        }
+
+        return sorted[(_sampleCount * 95 + 99) / 100 - 1];
+    }
+
+    // How long before a deadline to start.
+    inline uint32_t leadTime()
+    {
+        return max(mean(), p95()) + _margin;
+    }
+};
+
+#endif
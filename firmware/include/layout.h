@@ -0,0 +1,136 @@
+// Hardware layout
+//
+// Describes where the digits, dots and indicators sit on the NeoPixel strips.
+// The description is expanded at compile time into flat pixel tables,
+// and static checks reject pixels that overlap or fall off a strip.
+//
+// Version 1.0
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+
+// A single pixel: strip number and index along that strip.
+struct PixelRef
+{
+    uint8_t strip;
+    uint8_t index;
+};
+
+namespace layout
+{
+    // Strips, in GPIO order (see PIN_STRIP_x).
+    constexpr uint8_t stripCount = 3;
+    constexpr uint16_t stripLength[stripCount] = {42, 47, 34};
+
+    // Digits are runs of 7 segments, 3 pixels per segment.
+    // Index matches GenerateNumbers() output: 0 is the least significant digit.
+    constexpr uint8_t digitCount = 5;
+    constexpr uint8_t segmentsPerDigit = 7;
+    constexpr uint8_t pixelsPerSegment = 3;
+    constexpr uint8_t pixelsPerDigit = segmentsPerDigit * pixelsPerSegment;
+    constexpr PixelRef digitStart[digitCount] = {{2, 13}, {1, 26}, {1, 5}, {0, 21}, {0, 0}};
+
+    // Decimal point dots (5mm LEDs, red and green swapped).
+    constexpr uint8_t dotCount = 4;
+    constexpr PixelRef dots[dotCount] = {{1, 0}, {1, 1}, {1, 2}, {1, 3}};
+
+    // Connection status indicator (5mm LED, red and green swapped).
+    constexpr PixelRef status = {1, 4};
+
+    // "Spot Clock" text indicator.
+    constexpr uint8_t textCount = 7;
+    constexpr PixelRef text[textCount] = {{2, 0}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {2, 6}};
+
+    // Metal indicators, two pixels per metal.
+    constexpr uint8_t metalCount = 3;
+    constexpr uint8_t pixelsPerMetal = 2;
+    constexpr PixelRef metals[metalCount][pixelsPerMetal] = {{{2, 7}, {2, 8}}, {{2, 9}, {2, 10}}, {{2, 11}, {2, 12}}};
+
+    // Compiled tables.
+
+    template <int N>
+    struct PixelTable
+    {
+        PixelRef pixel[N];
+    };
+
+    constexpr int segmentPixelCount = digitCount * pixelsPerDigit;
+    constexpr int totalPixelCount = segmentPixelCount + dotCount + 1 + textCount + metalCount * pixelsPerMetal;
+
+    // Flat digit table, pixel [digit * pixelsPerDigit + i] belongs to segment i / pixelsPerSegment.
+    constexpr PixelTable<segmentPixelCount> makeSegmentTable()
+    {
+        PixelTable<segmentPixelCount> table{};
+        for (int d = 0; d < digitCount; d++)
+        {
+            for (int i = 0; i < pixelsPerDigit; i++)
+            {
+                table.pixel[d * pixelsPerDigit + i] = {digitStart[d].strip, (uint8_t)(digitStart[d].index + i)};
+            }
+        }
+        return table;
+    }
+
+    constexpr PixelTable<segmentPixelCount> segments = makeSegmentTable();
+
+    constexpr PixelTable<totalPixelCount> makeAllPixels()
+    {
+        PixelTable<totalPixelCount> table{};
+        int n = 0;
+        for (int i = 0; i < segmentPixelCount; i++)
+        {
+            table.pixel[n++] = segments.pixel[i];
+        }
+        for (int i = 0; i < dotCount; i++)
+        {
+            table.pixel[n++] = dots[i];
+        }
+        table.pixel[n++] = status;
+        for (int i = 0; i < textCount; i++)
+        {
+            table.pixel[n++] = text[i];
+        }
+        for (int m = 0; m < metalCount; m++)
+        {
+            for (int i = 0; i < pixelsPerMetal; i++)
+            {
+                table.pixel[n++] = metals[m][i];
+            }
+        }
+        return table;
+    }
+
+    constexpr bool inBounds(const PixelTable<totalPixelCount> &table)
+    {
+        for (int i = 0; i < totalPixelCount; i++)
+        {
+            if (table.pixel[i].strip >= stripCount || table.pixel[i].index >= stripLength[table.pixel[i].strip])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool noOverlap(const PixelTable<totalPixelCount> &table)
+    {
+        for (int i = 0; i < totalPixelCount; i++)
+        {
+            for (int j = i + 1; j < totalPixelCount; j++)
+            {
+                if (table.pixel[i].strip == table.pixel[j].strip && table.pixel[i].index == table.pixel[j].index)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(inBounds(makeAllPixels()), "Layout pixel lies outside of its strip.");
+    static_assert(noOverlap(makeAllPixels()), "Layout pixels overlap.");
+}
+
+#endif
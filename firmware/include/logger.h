@@ -0,0 +1,187 @@
+// Logger
+//
+// Non-blocking serial logger. Messages are formatted into a fixed ring
+// buffer and drained to the UART only as fast as its TX FIFO accepts them,
+// so logging never stalls the main loop. Messages that do not fit are
+// dropped and counted. Bulk output such as traces can wait for room()
+// and spread over several passes instead.
+//
+// Levels above LOG_LEVEL (set by build flag) compile away completely.
+//
+// Version 1.1
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Must be a power of two.
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 1024
+#endif
+
+#define LOG_LINE_SIZE 128
+
+class logger
+{
+
+private:
+    HardwareSerial *_out = nullptr;
+    char _buffer[LOG_BUFFER_SIZE];
+    uint16_t _head = 0; // Write position.
+    uint16_t _tail = 0; // Read position.
+    unsigned long _dropped = 0;
+    unsigned long _droppedReported = 0;
+
+    inline uint16_t used()
+    {
+        return (_head - _tail) & (LOG_BUFFER_SIZE - 1);
+    }
+
+    inline uint16_t space()
+    {
+        return LOG_BUFFER_SIZE - 1 - used();
+    }
+
+    // Push whole message or nothing.
+    bool push(const char *data, uint16_t length)
+    {
+        if (length > space())
+        {
+            _dropped++;
+            return false;
+        }
+
+        for (uint16_t i = 0; i < length; i++)
+        {
+            _buffer[_head] = data[i];
+            _head = (_head + 1) & (LOG_BUFFER_SIZE - 1);
+        }
+        return true;
+    }
+
+public:
+    inline void begin(HardwareSerial &out)
+    {
+        _out = &out;
+    }
+
+    // Format a line into the buffer, "\n" is appended.
+    // Lines longer than LOG_LINE_SIZE are truncated.
+    void printf(char level, const char *format, ...) __attribute__((format(printf, 3, 4)))
+    {
+        char line[LOG_LINE_SIZE];
+        line[0] = level;
+        line[1] = ' ';
+
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(line + 2, sizeof(line) - 3, format, args);
+        va_end(args);
+
+        if (length < 0)
+        {
+            return;
+        }
+
+        length = min(length + 2, (int)sizeof(line) - 2);
+        line[length++] = '\n';
+        push(line, length);
+    }
+
+    // Write buffered data without blocking, call from idle time.
+    void drain()
+    {
+        if (_out == nullptr)
+        {
+            return;
+        }
+
+        if (_dropped != _droppedReported && space() > 32)
+        {
+            char line[32];
+            int length = snprintf(line, sizeof(line), "W log dropped %lu\n", _dropped - _droppedReported);
+            if (push(line, length))
+            {
+                _droppedReported = _dropped;
+            }
+        }
+
+        int room = _out->availableForWrite();
+        while (room > 0 && used() > 0)
+        {
+            // Write the contiguous part up to the end of the ring.
+            uint16_t chunk = _head >= _tail ? _head - _tail : LOG_BUFFER_SIZE - _tail;
+            chunk = min((int)chunk, room);
+            _out->write((const uint8_t *)&_buffer[_tail], chunk);
+            _tail = (_tail + chunk) & (LOG_BUFFER_SIZE - 1);
+            room -= chunk;
+        }
+    }
+
+    // Block until the buffer is empty, for use before halting or restarting.
+    void flush()
+    {
+        while (used() > 0)
+        {
+            drain();
+            yield();
+        }
+    }
+
+    // Whether a full line fits with a line to spare for other messages.
+    inline bool room()
+    {
+        return space() >= 2 * LOG_LINE_SIZE;
+    }
+
+    inline unsigned long dropped()
+    {
+        return _dropped;
+    }
+};
+
+extern logger Log;
+
+// Hide a secret, keeping only whether it is set.
+inline const char *Redact(const String &secret)
+{
+    return secret.length() ? "********" : "(not set)";
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log.printf('E', __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log.printf('W', __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log.printf('I', __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log.printf('D', __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { } while (0)
+#endif
+
+#endif
@@ -2,7 +2,7 @@
 // 
 // In loop, non-blocking, timer.
 //
-// Version 1.0
+// Version 1.2
 
 
 #ifndef MS_TIMER_H
@@ -16,8 +16,8 @@ class msTimer
 {
 
 private:
-  unsigned long _oldMillis;
-  unsigned long _delay;
+  uint32_t _oldMillis;
+  uint32_t _delay;
 
 public:
   // Default Constructor.
@@ -28,7 +28,7 @@ public:
   }
 
   // Constructor.
-  msTimer(unsigned long delay = 0)
+  msTimer(uint32_t delay = 0)
   {
     _oldMillis = millis();
     _delay = delay;
@@ -36,9 +36,10 @@ public:
 
   // Returns true if delay has elapsed.
   // Reset delay.
+  // Compares elapsed time rather than deadlines so millis() rollover (~49 days) is handled.
   inline bool elapsed()
   {
-    if ((_oldMillis + _delay) < millis())
+    if ((millis() - _oldMillis) > _delay)
     {
       _oldMillis = millis();
       return 1;
@@ -49,18 +50,18 @@ public:
 
   inline void ForceTrigger()
   {
-    _oldMillis = 0;
+    _oldMillis = millis() - _delay - 1;
   }
 
   // Set delay and reset timer.
-  inline void setDelayAndReset(unsigned long delay)
+  inline void setDelayAndReset(uint32_t delay)
   {
     _delay = delay;
     _oldMillis = millis();
   }
 
   // Set delay and reset timer if delay is different.
-  inline void setDelay(unsigned long delay)
+  inline void setDelay(uint32_t delay)
   {
     if (_delay != delay)
     {
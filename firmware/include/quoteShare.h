@@ -0,0 +1,179 @@
+// Quote share
+//
+// Shares quotes between clocks on the LAN over UDP multicast.
+// A leader sends a compact binary snapshot of its quotes and time after
+// each fetch and as a periodic heartbeat. Followers use the snapshots
+// while the leader is heard, and fetch on their own when it goes quiet.
+// Each quote carries its age, so a heartbeat repeating an old price does
+// not make it look fresh.
+//
+// Version 1.2
+
+#ifndef QUOTE_SHARE_H
+#define QUOTE_SHARE_H
+
+#include <Arduino.h>
+#include "ESP8266WiFi.h"
+#include <WiFiUdp.h>
+
+#define SHARE_MAX_QUOTES 8
+
+const uint16_t shareMagic = 0x5153; // "SQ"
+const uint8_t shareVersion = 2;
+const int32_t sharePriceScale = 10000; // Fixed point, 4 decimals.
+
+enum class ShareMode
+{
+    Off,
+    Leader,
+    Follower
+};
+
+struct __attribute__((packed)) ShareHeader
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint32_t sequence;
+    uint32_t epoch; // Leader local epoch seconds, 0 if unknown.
+};
+
+struct __attribute__((packed)) ShareQuote
+{
+    char symbol[8];
+    int32_t open;       // Price * sharePriceScale.
+    int32_t close;      // Price * sharePriceScale.
+    uint32_t ageMillis; // Since the leader received the price.
+};
+
+class quoteShare
+{
+
+private:
+    WiFiUDP _udp;
+    ShareMode _mode = ShareMode::Off;
+    IPAddress _group;
+    uint16_t _port = 0;
+    bool _joined = false;
+    uint32_t _sequence = 0;
+    uint32_t _lastSendMillis = 0;
+    uint32_t _lastReceiveMillis = 0;
+    bool _received = false;
+    uint32_t _heartbeat = 10000;
+    uint32_t _timeout = 35000;
+
+    struct __attribute__((packed))
+    {
+        ShareHeader header;
+        ShareQuote quotes[SHARE_MAX_QUOTES];
+    } _packet;
+
+public:
+    inline void begin(ShareMode mode, IPAddress group, uint16_t port)
+    {
+        _mode = mode;
+        _group = group;
+        _port = port;
+        _joined = false;
+    }
+
+    inline ShareMode mode()
+    {
+        return _mode;
+    }
+
+    // Join the group once the network is up, call before send/receive.
+    bool join()
+    {
+        if (_mode == ShareMode::Off || _port == 0)
+        {
+            return false;
+        }
+
+        if (!_joined)
+        {
+            _joined = _mode == ShareMode::Follower ? _udp.beginMulticast(WiFi.localIP(), _group, _port) : _udp.begin(_port);
+        }
+        return _joined;
+    }
+
+    // Leader: true when a heartbeat snapshot is due.
+    inline bool heartbeatDue()
+    {
+        return _mode == ShareMode::Leader && millis() - _lastSendMillis >= _heartbeat;
+    }
+
+    // Leader: access the outgoing quote slots, then call send().
+    inline ShareQuote *quotes()
+    {
+        return _packet.quotes;
+    }
+
+    bool send(uint32_t epoch, uint8_t count)
+    {
+        if (_mode != ShareMode::Leader || !join())
+        {
+            return false;
+        }
+
+        count = min(count, (uint8_t)SHARE_MAX_QUOTES);
+        _packet.header.magic = shareMagic;
+        _packet.header.version = shareVersion;
+        _packet.header.count = count;
+        _packet.header.sequence = ++_sequence;
+        _packet.header.epoch = epoch;
+
+        size_t length = sizeof(ShareHeader) + count * sizeof(ShareQuote);
+
+        _lastSendMillis = millis();
+        return _udp.beginPacketMulticast(_group, _port, WiFi.localIP()) &&
+               _udp.write((const uint8_t *)&_packet, length) == length &&
+               _udp.endPacket();
+    }
+
+    // Follower: returns true with a valid snapshot, read it with header() and quotes().
+    bool receive()
+    {
+        if (_mode != ShareMode::Follower || !join())
+        {
+            return false;
+        }
+
+        int length = _udp.parsePacket();
+        if (length < (int)sizeof(ShareHeader) || length > (int)sizeof(_packet))
+        {
+            return false;
+        }
+
+        _udp.read((uint8_t *)&_packet, length);
+
+        if (_packet.header.magic != shareMagic || _packet.header.version != shareVersion ||
+            _packet.header.count > SHARE_MAX_QUOTES ||
+            length != (int)(sizeof(ShareHeader) + _packet.header.count * sizeof(ShareQuote)))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < _packet.header.count; i++)
+        {
+            _packet.quotes[i].symbol[sizeof(ShareQuote::symbol) - 1] = '\0';
+        }
+
+        _received = true;
+        _lastReceiveMillis = millis();
+        return true;
+    }
+
+    inline const ShareHeader &header()
+    {
+        return _packet.header;
+    }
+
+    // Follower: true while snapshots keep arriving.
+    inline bool leaderAlive()
+    {
+        return _mode == ShareMode::Follower && _received && millis() - _lastReceiveMillis < _timeout;
+    }
+};
+
+#endif
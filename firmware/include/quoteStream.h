@@ -0,0 +1,306 @@
+// Quote stream
+//
+// Non-blocking Server-Sent Events (SSE) client for a quote relay.
+// Holds one long-lived connection and parses tick lines in place
+// as bytes arrive, without heap allocation.
+// Connecting blocks for at most the connect timeout (DNS, then TCP),
+// failed connects back off exponentially.
+//
+// Expected tick line (open price and send time are optional):
+//   data: XAU 1923.45 1910.10 81234567
+//
+// The send time is the relay's clock in milliseconds. Its offset to
+// millis() is learned from the smallest (receive - send) difference seen
+// on the connection, so ticks can be timed from the relay, including the
+// time they waited in the socket buffer. The fastest tick sets zero, so
+// the shortest LAN transit is left out.
+//
+// Version 1.3
+
+#ifndef QUOTE_STREAM_H
+#define QUOTE_STREAM_H
+
+#include <Arduino.h>
+#include "ESP8266WiFi.h"
+
+class quoteStream
+{
+
+private:
+    WiFiClient _client;
+    String _host;
+    String _path;
+    uint16_t _port = 0;
+
+    char _line[64];
+    byte _lineLength = 0;
+    bool _lineOverflow = false;
+    uint32_t _lineMicros;
+
+    bool _headerDone = false;
+    uint32_t _lastDataMillis;
+    uint32_t _lastAttemptMillis;
+    uint32_t _retryDelay = 5000; // Doubles per failed connect, up to 64 times.
+    byte _failures = 0;               // Connects since the last good stream header.
+    uint32_t _connectTimeout = 1000;
+    uint32_t _idleTimeout = 30000;
+
+    char _symbol[8];
+    float _close;
+    float _open;
+    uint32_t _tickMicros;
+    bool _hasSentTime;
+    uint32_t _sentMillis;  // Relay clock.
+    uint32_t _clockOffset; // millis() - relay clock, smallest seen.
+    bool _offsetKnown = false;
+
+    // Parse a complete line held in _line.
+    // Returns true if the line was a valid tick.
+    bool parseLine()
+    {
+        const char *p = _line;
+
+        if (strncmp(p, "data:", 5) != 0)
+        {
+            return false;
+        }
+        p += 5;
+
+        while (*p == ' ')
+        {
+            p++;
+        }
+
+        byte n = 0;
+        while (*p != ' ' && *p != '\0' && n < sizeof(_symbol) - 1)
+        {
+            _symbol[n++] = *p++;
+        }
+        _symbol[n] = '\0';
+
+        if (n == 0 || *p != ' ')
+        {
+            return false;
+        }
+
+        char *end;
+        _close = strtof(p, &end);
+        if (end == p || _close <= 0)
+        {
+            return false;
+        }
+
+        p = end;
+        _open = strtof(p, &end);
+        if (end == p)
+        {
+            _open = 0;
+        }
+
+        p = end;
+        _sentMillis = strtoul(p, &end, 10);
+        _hasSentTime = end != p;
+        if (_hasSentTime)
+        {
+            uint32_t offset = millis() - _sentMillis;
+            if (!_offsetKnown || (int32_t)(offset - _clockOffset) < 0)
+            {
+                _clockOffset = offset;
+                _offsetKnown = true;
+            }
+        }
+
+        _tickMicros = _lineMicros;
+        return true;
+    }
+
+    bool connect()
+    {
+        _lastAttemptMillis = millis();
+
+        // Counted as failed until the stream header arrives.
+        if (_failures < 7)
+        {
+            _failures++;
+        }
+
+        IPAddress address;
+        if (!WiFi.hostByName(_host.c_str(), address, _connectTimeout))
+        {
+            return false;
+        }
+
+        _client.setTimeout(_connectTimeout);
+        if (!_client.connect(address, _port))
+        {
+            return false;
+        }
+
+        _client.setNoDelay(true);
+        _client.print("GET " + _path + " HTTP/1.1\r\n" +
+                      "Host: " + _host + "\r\n" +
+                      "Accept: text/event-stream\r\n" +
+                      "Cache-Control: no-cache\r\n" +
+                      "Connection: keep-alive\r\n\r\n");
+
+        _headerDone = false;
+        _lineLength = 0;
+        _lineOverflow = false;
+        _offsetKnown = false; // Possibly another relay.
+        _lastDataMillis = millis();
+        return true;
+    }
+
+public:
+    // Default Constructor.
+    quoteStream()
+    {
+        _lastAttemptMillis = 0;
+        _lastDataMillis = 0;
+    }
+
+    // Set relay address. An empty host disables the stream.
+    inline void begin(String host, uint16_t port, String path)
+    {
+        _host = host;
+        _port = port;
+        _path = path.length() ? path : "/";
+        _failures = 0;
+    }
+
+    inline bool enabled()
+    {
+        return _host.length() > 0 && _port != 0;
+    }
+
+    // Returns true if the stream is connected and has not gone quiet.
+    inline bool live()
+    {
+        return _client.connected() && _headerDone && (millis() - _lastDataMillis) < _idleTimeout;
+    }
+
+    inline void stop()
+    {
+        _client.stop();
+        _headerDone = false;
+    }
+
+    // Consume available bytes without blocking.
+    // Returns true when a tick has been parsed, read it with symbol(), close(), open().
+    // Call again until false to drain all pending ticks.
+    bool poll()
+    {
+        if (!enabled())
+        {
+            return false;
+        }
+
+        if (!_client.connected() || (millis() - _lastDataMillis) > _idleTimeout)
+        {
+            stop();
+
+            if ((_failures && millis() - _lastAttemptMillis < _retryDelay << (_failures - 1)) || !connect())
+            {
+                return false;
+            }
+        }
+
+        while (_client.available())
+        {
+            int c = _client.read();
+
+            if (c < 0)
+            {
+                break;
+            }
+
+            if (_lineLength == 0 && !_lineOverflow)
+            {
+                _lineMicros = micros();
+            }
+
+            _lastDataMillis = millis();
+
+            if (c == '\r')
+            {
+                continue;
+            }
+
+            if (c != '\n')
+            {
+                if (_lineLength < sizeof(_line) - 1)
+                {
+                    _line[_lineLength++] = c;
+                }
+                else
+                {
+                    _lineOverflow = true;
+                }
+                continue;
+            }
+
+            _line[_lineLength] = '\0';
+            bool tick = false;
+
+            if (!_headerDone)
+            {
+                // HTTP response header ends with an empty line.
+                if (_lineLength == 0)
+                {
+                    _headerDone = true;
+                    _failures = 0;
+                }
+            }
+            else if (!_lineOverflow)
+            {
+                tick = parseLine();
+            }
+
+            _lineLength = 0;
+            _lineOverflow = false;
+
+            if (tick)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline const char *symbol()
+    {
+        return _symbol;
+    }
+
+    inline float close()
+    {
+        return _close;
+    }
+
+    // Returns 0 if the tick did not carry an open price.
+    inline float open()
+    {
+        return _open;
+    }
+
+    // Micros timestamp of the first byte of the last tick, as read from the socket.
+    inline uint32_t tickMicros()
+    {
+        return _tickMicros;
+    }
+
+    // Whether the last tick carried the relay's send time.
+    inline bool hasSentTime()
+    {
+        return _hasSentTime;
+    }
+
+    // Send time of the last tick in millis(), see the offset note above.
+    inline uint32_t sentMillis()
+    {
+        return _sentMillis + _clockOffset;
+    }
+};
+
+#endif
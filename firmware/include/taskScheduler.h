@@ -0,0 +1,172 @@
+// Task scheduler
+//
+// Cooperative scheduler for short task slices. Each pass runs every ready
+// task once, highest priority first, re-checking priorities after each
+// slice. yield() is called between slices to feed the watchdog.
+// Per-task CPU time, worst slice, worst start latency and budget overruns
+// are recorded.
+//
+// Tasks that must wait mid-way can be written as stackless coroutines
+// with TASK_BEGIN / TASK_YIELD / TASK_END (locals must be static).
+//
+// Version 1.1
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define TASK_MAX 8
+
+// Stackless coroutine helpers (protothread style).
+// No switch statements between BEGIN and END, at most one TASK_YIELD per line.
+#define TASK_BEGIN()                 \
+    static uint16_t _taskResume = 0; \
+    switch (_taskResume)             \
+    {                                \
+    case 0:
+#define TASK_YIELD()                \
+    do                              \
+    {                               \
+        _taskResume = __LINE__;     \
+        return;                     \
+    case __LINE__:;                 \
+    } while (0)
+#define TASK_END() \
+    }              \
+    _taskResume = 0
+
+struct TaskStats
+{
+    const char *name;
+    uint32_t runs;
+    uint32_t cpuMicros;
+    uint32_t worstSliceMicros;
+    uint32_t worstLatencyMicros;
+    uint32_t overruns;
+};
+
+class taskScheduler
+{
+
+private:
+    struct Task
+    {
+        void (*run)();
+        uint8_t priority;
+        uint32_t periodMicros;
+        uint32_t budgetMicros;
+        uint32_t lastStartMicros;
+        TaskStats stats;
+    };
+
+    Task _tasks[TASK_MAX];
+    uint8_t _taskCount = 0;
+    int8_t _current = -1;
+    uint32_t _sliceStartMicros;
+
+public:
+    // Add a task, tasks are kept in priority order (highest first).
+    // Period 0 runs the task on every pass. Budget is the expected worst slice.
+    bool add(const char *name, void (*run)(), uint8_t priority, uint32_t periodMillis, uint32_t budgetMicros)
+    {
+        if (_taskCount >= TASK_MAX)
+        {
+            return false;
+        }
+
+        int i = _taskCount++;
+        while (i > 0 && _tasks[i - 1].priority < priority)
+        {
+            _tasks[i] = _tasks[i - 1];
+            i--;
+        }
+
+        Task &task = _tasks[i];
+        memset(&task, 0, sizeof(task));
+        task.run = run;
+        task.priority = priority;
+        task.periodMicros = periodMillis * 1000;
+        task.budgetMicros = budgetMicros;
+        task.lastStartMicros = micros() - task.periodMicros;
+        task.stats.name = name;
+        return true;
+    }
+
+    // One scheduling pass, call from loop().
+    void run()
+    {
+        uint32_t done = 0;
+
+        while (true)
+        {
+            uint32_t now = micros();
+            int next = -1;
+
+            for (int i = 0; i < _taskCount; i++)
+            {
+                if (!(done & (1UL << i)) && now - _tasks[i].lastStartMicros >= _tasks[i].periodMicros)
+                {
+                    next = i;
+                    break;
+                }
+            }
+
+            if (next < 0)
+            {
+                return;
+            }
+
+            Task &task = _tasks[next];
+            done |= 1UL << next;
+
+            uint32_t latency = now - task.lastStartMicros - task.periodMicros;
+            task.lastStartMicros = now;
+
+            _current = next;
+            _sliceStartMicros = now;
+            task.run();
+            _current = -1;
+
+            uint32_t slice = micros() - now;
+            task.stats.runs++;
+            task.stats.cpuMicros += slice;
+            task.stats.worstSliceMicros = max(task.stats.worstSliceMicros, slice);
+            task.stats.worstLatencyMicros = max(task.stats.worstLatencyMicros, latency);
+            if (slice > task.budgetMicros)
+            {
+                task.stats.overruns++;
+            }
+
+            yield();
+        }
+    }
+
+    // True if the running task has used up its slice budget, for tasks that loop over pending work.
+    inline bool overBudget()
+    {
+        return _current >= 0 && micros() - _sliceStartMicros > _tasks[_current].budgetMicros;
+    }
+
+    inline uint8_t taskCount()
+    {
+        return _taskCount;
+    }
+
+    inline const TaskStats &stats(uint8_t index)
+    {
+        return _tasks[index].stats;
+    }
+
+    void resetStats()
+    {
+        for (int i = 0; i < _taskCount; i++)
+        {
+            const char *name = _tasks[i].stats.name;
+            memset(&_tasks[i].stats, 0, sizeof(TaskStats));
+            _tasks[i].stats.name = name;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,264 @@
+// Tick log
+//
+// Appends quotes to the SD card in the binary format of tickLogFormat.h.
+// Records are collected in a RAM block and written as whole 512 byte
+// sectors: when the block fills, when the day changes, when its symbol
+// table is full, and periodically in place so little is lost on power
+// failure.
+//
+// Version 1.2
+
+#ifndef TICK_LOG_H
+#define TICK_LOG_H
+
+#include <Arduino.h>
+#include <SDFS.h>
+#include "tickLogFormat.h"
+
+class tickLog
+{
+
+private:
+    const char *_dataPath;
+    const char *_indexPath;
+
+    union
+    {
+        uint8_t bytes[tickLogBlockSize];
+        struct
+        {
+            TickBlockHeader header;
+            TickSymbolTable symbols;
+            TickRecord records[tickLogRecordsPerBlock];
+        };
+    } _block;
+
+    uint32_t _blockNumber = 0; // Position of the RAM block in the data file.
+    bool _blockOpen = false;
+    bool _dirty = false;
+    bool _ready = false;
+    uint32_t _flushInterval = 600000;
+    uint32_t _lastFlushMillis = 0;
+    unsigned long _writeErrors = 0;
+
+    // Open for read/write without truncating, creating if needed.
+    static fs::File openForUpdate(const char *path)
+    {
+        if (!SDFS.exists(path))
+        {
+            fs::File file = SDFS.open(path, "w");
+            file.close();
+        }
+        return SDFS.open(path, "r+");
+    }
+
+    bool writeBlock()
+    {
+        fs::File file = openForUpdate(_dataPath);
+
+        bool success = file && file.seek(_blockNumber * tickLogBlockSize) &&
+                       file.write(_block.bytes, tickLogBlockSize) == tickLogBlockSize;
+        file.close();
+
+        if (!success)
+        {
+            _writeErrors++;
+            return false;
+        }
+
+        _dirty = false;
+        _lastFlushMillis = millis();
+        return true;
+    }
+
+    // Record the first block of a day, keeping an existing entry.
+    bool writeIndex(uint32_t day, uint32_t blockNumber)
+    {
+        fs::File file = openForUpdate(_indexPath);
+
+        if (!file)
+        {
+            _writeErrors++;
+            return false;
+        }
+
+        TickIndexHeader header;
+        if (file.size() < sizeof(header) || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+            header.magic != tickLogIndexMagic)
+        {
+            header.magic = tickLogIndexMagic;
+            header.firstDay = day;
+            file.seek(0);
+            file.write((const uint8_t *)&header, sizeof(header));
+        }
+
+        // Clock moved before the start of the log.
+        if (day < header.firstDay)
+        {
+            file.close();
+            return false;
+        }
+
+        uint32_t offset = sizeof(header) + (day - header.firstDay) * sizeof(uint32_t);
+        uint32_t entry = 0;
+
+        if (file.size() >= offset + sizeof(entry))
+        {
+            file.seek(offset);
+            file.read((uint8_t *)&entry, sizeof(entry));
+        }
+        else
+        {
+            // Pad days without data.
+            file.seek(file.size());
+            while (file.size() < offset)
+            {
+                file.write((const uint8_t *)&entry, sizeof(entry));
+            }
+        }
+
+        if (entry == 0)
+        {
+            entry = blockNumber + 1;
+            file.seek(offset);
+            file.write((const uint8_t *)&entry, sizeof(entry));
+        }
+
+        file.close();
+        return true;
+    }
+
+    void startBlock(uint32_t time)
+    {
+        if (_blockOpen)
+        {
+            if (_dirty)
+            {
+                writeBlock();
+            }
+            _blockNumber++;
+        }
+
+        memset(_block.bytes, 0, sizeof(_block.bytes));
+        _block.header.magic = tickLogBlockMagic;
+        _block.header.version = tickLogVersion;
+        _block.header.baseTime = time;
+        _blockOpen = true;
+
+        writeIndex(time / tickLogSecondsPerDay, _blockNumber);
+    }
+
+    // Position of a symbol in the block's table, added if new, -1 if the table is full.
+    int findSymbol(const char *symbol)
+    {
+        TickSymbolTable &table = _block.symbols;
+
+        for (int i = 0; i < table.count; i++)
+        {
+            if (strncmp(table.symbols[i], symbol, tickLogSymbolSize) == 0)
+            {
+                return i;
+            }
+        }
+
+        if (table.count >= tickLogMaxSymbols)
+        {
+            return -1;
+        }
+
+        strncpy(table.symbols[table.count], symbol, tickLogSymbolSize);
+        return table.count++;
+    }
+
+public:
+    // Constructor.
+    tickLog(const char *dataPath, const char *indexPath)
+    {
+        _dataPath = dataPath;
+        _indexPath = indexPath;
+    }
+
+    // Call after the SD card is mounted, new records start on a fresh block.
+    bool begin()
+    {
+        fs::File file = openForUpdate(_dataPath);
+
+        if (!file)
+        {
+            return false;
+        }
+
+        _blockNumber = (file.size() + tickLogBlockSize - 1) / tickLogBlockSize;
+        file.close();
+
+        _blockOpen = false;
+        _ready = true;
+        return true;
+    }
+
+    inline void setFlushInterval(uint32_t interval)
+    {
+        _flushInterval = interval;
+    }
+
+    // Add a quote, time in local epoch seconds, source one of tickLogSource*.
+    bool append(uint32_t time, const char *symbol, float price, uint8_t source = tickLogSourcePoll)
+    {
+        if (!_ready || time == 0 || strlen(symbol) == 0 || strlen(symbol) >= tickLogSymbolSize)
+        {
+            return false;
+        }
+
+        if (!_blockOpen ||
+            _block.header.count >= tickLogRecordsPerBlock ||
+            time < _block.header.baseTime ||
+            time - _block.header.baseTime > UINT16_MAX ||
+            time / tickLogSecondsPerDay != _block.header.baseTime / tickLogSecondsPerDay)
+        {
+            startBlock(time);
+        }
+
+        int index = findSymbol(symbol);
+        if (index < 0)
+        {
+            startBlock(time);
+            index = findSymbol(symbol);
+        }
+
+        TickRecord &record = _block.records[_block.header.count++];
+        record.deltaSeconds = time - _block.header.baseTime;
+        record.symbol = index;
+        record.flags = source & tickLogSourceMask;
+        record.price = lround(price * tickLogPriceScale);
+
+        _dirty = true;
+
+        if (_block.header.count == tickLogRecordsPerBlock)
+        {
+            return writeBlock();
+        }
+        return true;
+    }
+
+    // Periodically rewrite the partial block in place.
+    void update()
+    {
+        if (_dirty && millis() - _lastFlushMillis > _flushInterval)
+        {
+            writeBlock();
+        }
+    }
+
+    // Write the partial block now.
+    inline bool flush()
+    {
+        return !_dirty || writeBlock();
+    }
+
+    inline unsigned long writeErrors()
+    {
+        return _writeErrors;
+    }
+};
+
+#endif
@@ -0,0 +1,111 @@
+// Tick log format
+//
+// Binary quote log layout shared by the firmware and the host decoder
+// (tools/ticklog). No Arduino dependencies.
+//
+// ticks.bin: sequence of 512 byte blocks (one SD sector each).
+//   Block header, symbol table, then up to tickLogRecordsPerBlock fixed
+//   size records. A record names its instrument by position in the
+//   symbol table of its own block, so a block decodes the same whatever
+//   the instrument configuration was. Version 1 blocks have no symbol
+//   table, their records hold the configured instrument index.
+//   Record time is a delta in seconds from the block base time.
+//   A block never spans two days.
+//
+// ticks.idx: index header, then one uint32 per day since firstDay
+//   holding (first block number of that day + 1), 0 if the day has no data.
+//
+// All fields little endian. Times are local epoch seconds (clock time zone).
+//
+// Version 1.1
+
+#ifndef TICK_LOG_FORMAT_H
+#define TICK_LOG_FORMAT_H
+
+#include <stdint.h>
+
+const uint16_t tickLogBlockMagic = 0x4B54; // "TK"
+const uint32_t tickLogIndexMagic = 0x58444954; // "TIDX"
+const uint8_t tickLogVersion = 2;
+
+const uint16_t tickLogBlockSize = 512;
+const int32_t tickLogPriceScale = 10000; // Fixed point, 4 decimals.
+const uint32_t tickLogSecondsPerDay = 86400;
+
+const uint8_t tickLogMaxSymbols = 8;
+const uint8_t tickLogSymbolSize = 8; // NUL padded.
+
+// Record flags: where the quote came from.
+const uint8_t tickLogSourceMask = 0x03;
+const uint8_t tickLogSourcePoll = 0;   // Fetched from the spot API.
+const uint8_t tickLogSourceStream = 1; // Quote stream.
+const uint8_t tickLogSourceShare = 2;  // LAN leader.
+
+struct __attribute__((packed)) TickBlockHeader
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;     // Records used in this block.
+    uint32_t baseTime; // Local epoch seconds.
+};
+
+// Follows the block header from version 2.
+struct __attribute__((packed)) TickSymbolTable
+{
+    uint8_t count;
+    uint8_t reserved[7];
+    char symbols[tickLogMaxSymbols][tickLogSymbolSize];
+};
+
+struct __attribute__((packed)) TickRecord
+{
+    uint16_t deltaSeconds; // From block base time.
+    uint8_t symbol;        // Symbol table position (version 1: instrument index).
+    uint8_t flags;         // Source in the low bits.
+    int32_t price;         // Price * tickLogPriceScale.
+};
+
+struct __attribute__((packed)) TickIndexHeader
+{
+    uint32_t magic;
+    uint32_t firstDay; // Days since epoch.
+};
+
+const uint16_t tickLogRecordsOffset = sizeof(TickBlockHeader) + sizeof(TickSymbolTable);
+const uint16_t tickLogRecordsOffsetV1 = sizeof(TickBlockHeader);
+const uint8_t tickLogRecordsPerBlock = (tickLogBlockSize - tickLogRecordsOffset) / sizeof(TickRecord);
+const uint8_t tickLogRecordsPerBlockV1 = (tickLogBlockSize - tickLogRecordsOffsetV1) / sizeof(TickRecord);
+
+static_assert(sizeof(TickBlockHeader) == 8, "Unexpected block header size.");
+static_assert(sizeof(TickSymbolTable) == 72, "Unexpected symbol table size.");
+static_assert(sizeof(TickRecord) == 8, "Unexpected record size.");
+static_assert(tickLogRecordsOffset + tickLogRecordsPerBlock * sizeof(TickRecord) <= tickLogBlockSize, "Block overflow.");
+
+// Days since 1970-01-01 for a civil date (proleptic Gregorian).
+// http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+inline int32_t DaysFromCivil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = (uint32_t)(y - era * 400);
+    const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Civil date for days since 1970-01-01, inverse of DaysFromCivil.
+// http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+inline void CivilFromDays(int32_t z, int *year, int *month, int *day)
+{
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const uint32_t doe = (uint32_t)(z - era * 146097);
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const uint32_t mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = (int)yoe + era * 400 + (*month <= 2);
+}
+
+#endif
@@ -0,0 +1,326 @@
+// Wi-Fi connector
+//
+// Non-blocking Wi-Fi connection manager with fast reconnect.
+// The BSSID, channel and IP configuration of the last good connection are
+// cached in RTC memory (kept over resets, lost on power down). Reconnects
+// first try the cached access point with a static configuration, which
+// skips the scan and DHCP, then each configured network in turn with a
+// full scan. Every attempt is bounded by a timeout, failed rounds back off
+// exponentially. Connect times are kept in a histogram.
+//
+// The cached address is only refreshed from DHCP. Every few fast connects
+// the cached access point is joined with DHCP instead, so an expired or
+// reassigned lease is replaced. A failed fast attempt drops the cache, in
+// RTC memory too.
+//
+// Version 1.2
+
+#ifndef WIFI_CONNECTOR_H
+#define WIFI_CONNECTOR_H
+
+#include <Arduino.h>
+#include "ESP8266WiFi.h"
+
+#define WIFI_MAX_NETWORKS 4
+#define WIFI_HISTOGRAM_BUCKETS 7
+#define WIFI_RTC_OFFSET 0 // RTC user memory block (4 bytes each).
+#define WIFI_LEASE_CHECK_EVERY 8 // Fast connects between DHCP connects.
+
+// Histogram bucket upper bounds in milliseconds, the last bucket is open ended.
+const uint32_t wifiHistogramBounds[WIFI_HISTOGRAM_BUCKETS - 1] = {500, 1000, 2000, 4000, 8000, 16000};
+
+enum class WifiState
+{
+    Idle,
+    Connecting,
+    Connected,
+    Backoff
+};
+
+struct WifiStats
+{
+    uint32_t histogram[WIFI_HISTOGRAM_BUCKETS];
+    uint32_t fastConnects;
+    uint32_t fullConnects;
+    uint32_t failedAttempts;
+    uint32_t leaseChanges; // DHCP gave a different address than cached.
+    uint32_t lastConnectMillis;
+};
+
+class wifiConnector
+{
+
+private:
+    struct Network
+    {
+        String ssid;
+        String password;
+    };
+
+    // Size must be a multiple of 4 bytes for RTC memory.
+    struct RtcCache
+    {
+        uint32_t crc;
+        uint8_t network;
+        uint8_t channel;
+        uint8_t bssid[6];
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint32_t fastConnects; // Since the address was leased.
+    };
+
+    Network _networks[WIFI_MAX_NETWORKS];
+    uint8_t _networkCount = 0;
+    RtcCache _cache;
+    bool _cacheValid = false;
+
+    WifiState _state = WifiState::Idle;
+    int8_t _attempt;  // -1 for the cached access point, otherwise a network index.
+    int8_t _network = -1;
+    bool _dhcp;       // The attempt gets its address from DHCP.
+    uint32_t _attemptStartMillis;
+    uint32_t _connectStartMillis;
+    uint32_t _backoffMillis;
+    uint32_t _fastTimeout = 3000;
+    uint32_t _fullTimeout = 10000;
+    uint32_t _minBackoff = 5000;
+    uint32_t _maxBackoff = 60000;
+    WifiStats _stats = {};
+
+    static uint32_t crc32(const uint8_t *data, size_t length)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        while (length--)
+        {
+            crc ^= *data++;
+            for (int i = 0; i < 8; i++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+            }
+        }
+        return ~crc;
+    }
+
+    inline uint32_t cacheCrc()
+    {
+        return crc32((const uint8_t *)&_cache + sizeof(_cache.crc), sizeof(_cache) - sizeof(_cache.crc));
+    }
+
+    void loadCache()
+    {
+        _cacheValid = ESP.rtcUserMemoryRead(WIFI_RTC_OFFSET, (uint32_t *)&_cache, sizeof(_cache)) &&
+                      _cache.crc == cacheCrc() && _cache.network < _networkCount;
+    }
+
+    void writeCache()
+    {
+        _cache.crc = cacheCrc();
+        _cacheValid = ESP.rtcUserMemoryWrite(WIFI_RTC_OFFSET, (uint32_t *)&_cache, sizeof(_cache));
+    }
+
+    void dropCache()
+    {
+        _cacheValid = false;
+        _cache.crc = ~cacheCrc();
+        ESP.rtcUserMemoryWrite(WIFI_RTC_OFFSET, (uint32_t *)&_cache, sizeof(_cache));
+    }
+
+    // After a connect, the address is taken from DHCP connects only.
+    void saveCache()
+    {
+        if (!_dhcp)
+        {
+            _cache.fastConnects++;
+            writeCache();
+            return;
+        }
+
+        if (_cacheValid && _cache.network == _network && _cache.ip != (uint32_t)WiFi.localIP())
+        {
+            _stats.leaseChanges++;
+        }
+
+        _cache.network = _network;
+        _cache.channel = WiFi.channel();
+        memcpy(_cache.bssid, WiFi.BSSID(), sizeof(_cache.bssid));
+        _cache.ip = WiFi.localIP();
+        _cache.gateway = WiFi.gatewayIP();
+        _cache.subnet = WiFi.subnetMask();
+        _cache.dns = WiFi.dnsIP();
+        _cache.fastConnects = 0;
+        writeCache();
+    }
+
+    void startAttempt(int8_t attempt)
+    {
+        _attempt = attempt;
+        _attemptStartMillis = millis();
+        _state = WifiState::Connecting;
+
+        WiFi.disconnect();
+
+        // The cached access point with a static address, or with DHCP to check the lease.
+        _network = attempt < 0 ? _cache.network : attempt;
+        _dhcp = attempt >= 0 || _cache.fastConnects >= WIFI_LEASE_CHECK_EVERY;
+        if (_dhcp)
+        {
+            // A zero address switches back to DHCP.
+            WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+        }
+        else
+        {
+            WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+        }
+
+        if (attempt < 0)
+        {
+            WiFi.begin(_networks[_network].ssid, _networks[_network].password, _cache.channel, _cache.bssid);
+        }
+        else
+        {
+            WiFi.begin(_networks[_network].ssid, _networks[_network].password);
+        }
+    }
+
+    void startRound()
+    {
+        if (_networkCount == 0)
+        {
+            _state = WifiState::Idle;
+            return;
+        }
+        startAttempt(_cacheValid ? -1 : 0);
+    }
+
+    void recordConnect()
+    {
+        uint32_t elapsed = millis() - _connectStartMillis;
+        int bucket = 0;
+        while (bucket < WIFI_HISTOGRAM_BUCKETS - 1 && elapsed >= wifiHistogramBounds[bucket])
+        {
+            bucket++;
+        }
+
+        _stats.histogram[bucket]++;
+        _stats.lastConnectMillis = elapsed;
+        if (_attempt < 0)
+        {
+            _stats.fastConnects++;
+        }
+        else
+        {
+            _stats.fullConnects++;
+        }
+    }
+
+public:
+    bool addNetwork(const String &ssid, const String &password)
+    {
+        if (_networkCount >= WIFI_MAX_NETWORKS || ssid.length() == 0)
+        {
+            return false;
+        }
+
+        _networks[_networkCount].ssid = ssid;
+        _networks[_networkCount].password = password;
+        _networkCount++;
+        return true;
+    }
+
+    inline uint8_t networkCount()
+    {
+        return _networkCount;
+    }
+
+    // Start connecting, call after the networks are added.
+    void begin()
+    {
+        // Connections are managed here, not by the SDK (and not written to flash).
+        WiFi.persistent(false);
+        WiFi.mode(WIFI_STA);
+        WiFi.setAutoReconnect(false);
+
+        loadCache();
+        _backoffMillis = _minBackoff;
+        _connectStartMillis = millis();
+        startRound();
+    }
+
+    // Advance the connection state, returns true while connected.
+    bool update()
+    {
+        wl_status_t status = WiFi.status();
+
+        if (_state == WifiState::Connected)
+        {
+            if (status != WL_CONNECTED)
+            {
+                _connectStartMillis = millis();
+                startRound();
+            }
+        }
+        else if (_state == WifiState::Connecting)
+        {
+            if (status == WL_CONNECTED)
+            {
+                recordConnect();
+                saveCache();
+                _backoffMillis = _minBackoff;
+                _state = WifiState::Connected;
+            }
+            else if (status == WL_CONNECT_FAILED || status == WL_WRONG_PASSWORD || status == WL_NO_SSID_AVAIL ||
+                     millis() - _attemptStartMillis > (_dhcp ? _fullTimeout : _fastTimeout))
+            {
+                _stats.failedAttempts++;
+
+                // The cached access point or address failed, do a full scan
+                // from now on, also after a reset.
+                if (_attempt < 0)
+                {
+                    dropCache();
+                }
+
+                if (_attempt + 1 < _networkCount)
+                {
+                    startAttempt(_attempt + 1);
+                }
+                else
+                {
+                    WiFi.disconnect();
+                    _attemptStartMillis = millis();
+                    _state = WifiState::Backoff;
+                }
+            }
+        }
+        else if (_state == WifiState::Backoff)
+        {
+            if (millis() - _attemptStartMillis > _backoffMillis)
+            {
+                _backoffMillis = min(_backoffMillis * 2, _maxBackoff);
+                startRound();
+            }
+        }
+
+        return _state == WifiState::Connected;
+    }
+
+    inline WifiState state()
+    {
+        return _state;
+    }
+
+    // SSID of the current or last attempted network.
+    inline const char *ssid()
+    {
+        return _network >= 0 ? _networks[_network].ssid.c_str() : "";
+    }
+
+    inline const WifiStats &stats()
+    {
+        return _stats;
+    }
+};
+
+#endif
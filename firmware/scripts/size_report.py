@@ -0,0 +1,66 @@
+# Firmware footprint report
+#
+# PlatformIO post script (extra_scripts in platformio.ini). After linking,
+# prints IRAM, DRAM and flash usage and the largest symbols in each region,
+# and writes the full per-symbol list to .pio/build/<env>/footprint.txt.
+#
+# Regions are taken from the ESP8266 memory map by symbol address.
+
+import os
+import subprocess
+
+Import("env")
+
+REGIONS = [
+    ("IRAM", 0x40100000, 0x40110000),
+    ("DRAM", 0x3FFE8000, 0x40000000),
+    ("Flash", 0x40200000, 0x40400000),
+]
+
+TOP_SYMBOLS = 10
+
+
+def region_of(address):
+    for name, start, end in REGIONS:
+        if start <= address < end:
+            return name
+    return None
+
+
+def read_symbols(nm, elf, path):
+    output = subprocess.check_output(
+        [nm, "--print-size", "--size-sort", "--demangle", elf],
+        env={**os.environ, "PATH": path},
+        universal_newlines=True,
+    )
+
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        address, size, kind, name = fields
+        region = region_of(int(address, 16))
+        if region:
+            symbols.append((region, int(size, 16), kind, name))
+    return symbols
+
+
+def report(target, source, env):
+    elf = str(target[0])
+    nm = env.subst("$CC").replace("gcc", "nm")
+    symbols = read_symbols(nm, elf, env["ENV"]["PATH"])
+
+    print("Footprint report")
+    for name, _, _ in REGIONS:
+        region = sorted((s for s in symbols if s[0] == name), key=lambda s: s[1], reverse=True)
+        print("  %-5s %7d bytes in %d symbols" % (name, sum(s[1] for s in region), len(region)))
+        for _, size, kind, symbol in region[:TOP_SYMBOLS]:
+            print("        %7d %s %s" % (size, kind, symbol[:90]))
+
+    with open(os.path.join(env.subst("$BUILD_DIR"), "footprint.txt"), "w") as file:
+        for region, size, kind, symbol in sorted(symbols, key=lambda s: (s[0], -s[1])):
+            file.write("%s\t%d\t%s\t%s\n" % (region, size, kind, symbol))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
@@ -30,44 +30,137 @@
 #include <Arduino.h>
 #include "msTimer.h" // Local libary.
 #include "flasher.h" // Local libary.
+#include "quoteStream.h" // Local libary.
+#include "alertEngine.h" // Local libary.
+#include "layout.h"      // Local libary.
+#include "logger.h"      // Local libary.
+#include "tickLog.h"     // Local libary.
+#include "buttonEvents.h" // Local libary.
+#include "taskScheduler.h" // Local libary.
+#include "latencyEstimator.h" // Local libary.
+#include "quoteShare.h" // Local libary.
+#include "wifiConnector.h" // Local libary.
 #include <SPI.h>
 #include <SD.h>
 #include "ESP8266WiFi.h"
+#include <WiFiClientSecure.h>
 #include <esp8266httpclient.h>
 #include "ArduinoJson.h"
 #include <Adafruit_NeoPixel.h> // https://github.com/adafruit/Adafruit_NeoPixel
-#include <JC_Button.h>         // https://github.com/JChristensen/JC_Button
 
 #define PIN_STRIP_1 5       // GPIO PIN NUMBER
 #define PIN_STRIP_2 4       // GPIO PIN NUMBER
 #define PIN_STRIP_3 0       // GPIO PIN NUMBER
 #define PIN_BUTTON_SELECT 2 // GPIO PIN NUMBER
 
-const int stripStatusIndicatorIndex = 4;
-
 // Due to hardware limitations of the ESP8266 long WS2812b strips are not possible.
 // Therefore segments, indicators, and dots are combined in a awkward combination to prevent flickering.
-Adafruit_NeoPixel strip1 = Adafruit_NeoPixel(42, PIN_STRIP_1, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel strip2 = Adafruit_NeoPixel(47, PIN_STRIP_2, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel strip3 = Adafruit_NeoPixel(34, PIN_STRIP_3, NEO_GRB + NEO_KHZ800);
+// Pixel placement is described in layout.h.
+Adafruit_NeoPixel strip1 = Adafruit_NeoPixel(layout::stripLength[0], PIN_STRIP_1, NEO_GRB + NEO_KHZ800);
+Adafruit_NeoPixel strip2 = Adafruit_NeoPixel(layout::stripLength[1], PIN_STRIP_2, NEO_GRB + NEO_KHZ800);
+Adafruit_NeoPixel strip3 = Adafruit_NeoPixel(layout::stripLength[2], PIN_STRIP_3, NEO_GRB + NEO_KHZ800);
+
+Adafruit_NeoPixel *strips[layout::stripCount] = {&strip1, &strip2, &strip3};
+
+buttonEvents buttonSelect(PIN_BUTTON_SELECT, 25, 1000);
+
+// Automatic instrument cycling, paused by a long press.
+msTimer timerInstrumentSelection(4000);
+bool holdSelection = false;
 
-Button buttonSelect(PIN_BUTTON_SELECT, 25, false, true);
+logger Log;
+
+// loop() runs the input, render, network and housekeeping tasks.
+taskScheduler scheduler;
 
 // SD card parameters.
 String ssid, password, timeZone;
 int brightness, cycleDelay;
+String streamHost, streamPath;
+int streamPort;
+String shareMode, shareGroup;
+int sharePort;
 
 const char *wifiFilePath = "/wifi.txt";
 const int chipSelect = D8;
 const int blankSegment = 10;
 const int dashSegment = 11;
 
-struct MetalSpot
+#define MAX_INSTRUMENTS 8
+
+static_assert(MAX_INSTRUMENTS <= ALERT_MAX_INSTRUMENTS, "Alert engine must cover every instrument.");
+
+// Instruments are configured on the SD card, the default is Au, Ag, Pt.
+struct Instrument
 {
-    float open;
+    char symbol[8];           // API symbol, e.g. "XAU".
+    uint8_t priority;         // Share of the API call budget.
+    int8_t indicator;         // Indicator on the front panel, -1 for none.
+    bool fetched;             // Fetched at least once.
+    float open;               // First price of the local day, unless pushed with the quote.
     float close;
-    float percentage;
-} metalSpot[3];
+    uint32_t openDay;         // Local day (epoch days) of the open price.
+    uint32_t fetchInterval;   // Milliseconds, derived from the API call budget, 0 for not polled.
+    uint32_t deadlineMillis;  // When the next fresh price is wanted.
+    uint32_t updatedMillis;   // When the price was last received.
+} instruments[MAX_INSTRUMENTS];
+
+static_assert(sizeof(Instrument::symbol) == sizeof(ShareQuote::symbol), "Shared symbols are copied whole.");
+
+int instrumentCount;
+
+// Allowed API calls per hour, shared by all instruments. 0 turns polling off,
+// prices then come only from the stream or a leader clock.
+int apiCallsPerHour;
+const int apiCallsPerFetch = 1;
+const uint32_t minFetchInterval = 60000;
+
+// Fetches start early by the expected fetch latency so prices are fresh at their deadline.
+// The spot API connection is kept open between fetches (keep-alive) and opened
+// ahead of a due fetch when it was closed.
+const char *spotApiHost = "www.goldapi.io";
+const uint16_t spotApiPort = 443;
+const uint32_t connectWarmLead = 5000;
+WiFiClientSecure spotClient;
+latencyEstimator fetchLatency(3000, 250);
+
+// Age of the displayed price at each display update.
+struct Staleness
+{
+    uint32_t count;
+    uint32_t sumMillis;
+    uint32_t maxMillis;
+} staleness;
+
+// Metal prices are always fetched in USD. Other currencies are converted
+// locally in fixed point from one FX rate table fetch per refresh.
+#define MAX_CURRENCIES 6
+const int32_t fxRateScale = 1000000;  // Fixed point, 6 decimals.
+const int32_t fxPriceScale = 10000;   // Fixed point, 4 decimals.
+
+struct Currency
+{
+    char code[4]; // ISO code, e.g. "EUR".
+    int32_t rate; // Units per USD * fxRateScale, 0 until fetched.
+} currencies[MAX_CURRENCIES];
+
+int currencyCount;
+int selectedCurrency; // Index into currencies.
+String fxUrl;
+uint32_t fxRefreshInterval;
+const uint32_t fxRetryInterval = 60000; // Until the first rate table arrives.
+
+// API calls since the last health trace, reported per displayed price.
+struct ApiUsage
+{
+    uint32_t spotCalls;
+    uint32_t fxCalls;
+} apiUsage;
+
+// Alert rules are loaded from the SD card, a triggered alert sets the display color and pattern.
+alertEngine alerts;
+flasher alertFlasher(Pattern::OnOff, 1000, 255);
+bool alertBlank = false;
 
 enum IndicatorStatus
 {
@@ -89,7 +182,44 @@ struct TimeDate
     int minute;
 } curTimeDate;
 
-int selectedMetal; // 0 = Au, 1 = Ag, 2 = Pt
+// Local epoch seconds at the last time update, 0 until synced.
+uint32_t timeSyncEpoch;
+uint32_t timeSyncMillis;
+
+// Binary log of fetched, streamed and shared quotes on the SD card, see tickLogFormat.h.
+tickLog ticks("/ticks.bin", "/ticks.idx");
+
+int selectedInstrument; // Index into instruments.
+
+// Optional push-based quote source, polling is used while the stream is down.
+quoteStream stream;
+
+// Latency of streamed ticks: read-to-pixel (first byte read from the socket to
+// display updated), and end-to-end from the relay's send time when ticks carry it.
+struct StreamLatency
+{
+    uint32_t count;
+    uint32_t sumMicros;
+    uint32_t maxMicros;
+    uint32_t endToEndCount;
+    uint32_t sumEndToEndMillis;
+    uint32_t maxEndToEndMillis;
+} streamLatency;
+
+// Press-to-pixel latency of the select button (edge captured to display updated).
+struct PressLatency
+{
+    uint32_t count;
+    uint32_t sumMicros;
+    uint32_t maxMicros;
+} pressLatency;
+
+// Optional LAN sharing: a leader fetches and multicasts, followers listen
+// and fetch on their own only while the leader is quiet.
+quoteShare share;
+
+// Wi-Fi with fast reconnect to the last access point and fallback networks.
+wifiConnector wifi;
 
 const uint32_t OFF = 0x0000000;
 const uint32_t RED = 0x00FF0000;
@@ -104,19 +234,56 @@ const uint32_t BLUE_DIM = 0x00000030;
 const uint32_t YELLOW_DIM = 0x002F2F00;
 const uint32_t MAGENTA_DIM = 0x002F002F;
 
+// Metal indicator color per currency (yellow is used for hold).
+const uint32_t currencyColors[MAX_CURRENCIES] = {BLUE, GREEN, MAGENTA, RED, 0x0000F0F0, 0x00F08000};
+
+// Memory placement: code stays in flash unless it must run from IRAM (interrupt
+// handlers). The render path is not pinned: a frame's time is dominated by show(),
+// which IRAM does not speed up. Any other placement change needs a measured gain
+// in the compose time of the render timing below, compared before and after.
+// Small tables read once per digit live in flash (PROGMEM). Every build prints a
+// footprint report (scripts/size_report.py).
+
 // Convert decimal value to segments (hardware does not follow 7-segment display convention).
-const int decimalToSegmentValues[12][7] = {{1, 1, 1, 1, 1, 1, 0},  // 0
-                                           {0, 0, 0, 1, 1, 0, 0},  // 1
-                                           {1, 0, 1, 1, 0, 1, 1},  // 2
-                                           {0, 0, 1, 1, 1, 1, 1},  // 3
-                                           {0, 1, 0, 1, 1, 0, 1},  // 4
-                                           {0, 1, 1, 0, 1, 1, 1},  // 5
-                                           {1, 1, 0, 0, 1, 1, 1},  // 6
-                                           {0, 0, 1, 1, 1, 0, 0},  // 7
-                                           {1, 1, 1, 1, 1, 1, 1},  // 8
-                                           {0, 1, 1, 1, 1, 0, 1},  // 9
-                                           {0, 0, 0, 0, 0, 0, 0},  // 10 / ALL OFF
-                                           {0, 0, 0, 0, 0, 0, 1}}; // 11 / Center dash
+// Bit n is segment n.
+const uint8_t decimalToSegmentValues[12] PROGMEM = {0b0111111,  // 0
+                                                    0b0011000,  // 1
+                                                    0b1101101,  // 2
+                                                    0b1111100,  // 3
+                                                    0b1011010,  // 4
+                                                    0b1110110,  // 5
+                                                    0b1110011,  // 6
+                                                    0b0011100,  // 7
+                                                    0b1111111,  // 8
+                                                    0b1011110,  // 9
+                                                    0b0000000,  // 10 / ALL OFF
+                                                    0b1000000}; // 11 / Center dash
+
+// Render timing (compose and show), the before/after check for placement changes.
+// Flash cache misses show up in the compose time.
+struct RenderTiming
+{
+    uint32_t count;
+    uint32_t composeMicros;
+    uint32_t showMicros;
+    uint32_t worstMicros;
+} renderTiming;
+
+// Supply current limit. Each frame's current is estimated from the pixel
+// buffers before show() and the frame is scaled down to fit the budget.
+// WS2812b: about 20 mA per channel at full on, about 1 mA idle per LED.
+const uint32_t ledChannelMa = 20;
+const uint32_t ledIdleMa = 1;
+uint32_t powerBudgetMa; // 0 for no limit.
+
+struct PowerStats
+{
+    uint32_t frames;
+    uint32_t limited; // Frames scaled down to the budget.
+    uint32_t peakMa;  // Highest estimate before scaling.
+    uint32_t limitMicros; // Time in LimitPower(), all frames.
+    uint32_t worstMicros;
+} powerStats;
 
 // https://www.geeksforgeeks.org/find-day-of-the-week-for-a-given-date/
 int dayofweek(int d, int m, int y)
@@ -165,47 +332,319 @@ uint32_t SwapRG(uint32_t color)
     return Color(g, r, b);
 }
 
+inline void SetPixel(PixelRef pixel, uint32_t color)
+{
+    strips[pixel.strip]->setPixelColor(pixel.index, color);
+}
+
+inline uint32_t GetPixel(PixelRef pixel)
+{
+    return strips[pixel.strip]->getPixelColor(pixel.index);
+}
+
+// Local time in epoch seconds, 0 if the time has not been fetched yet.
+uint32_t LocalEpoch()
+{
+    if (timeSyncEpoch == 0)
+    {
+        return 0;
+    }
+    return timeSyncEpoch + (millis() - timeSyncMillis) / 1000;
+}
+
+// Set the local time from epoch seconds (e.g. received from a leader clock).
+void SetTimeFromEpoch(uint32_t epoch)
+{
+    timeSyncEpoch = epoch;
+    timeSyncMillis = millis();
+
+    CivilFromDays(epoch / tickLogSecondsPerDay, &curTimeDate.year, &curTimeDate.month, &curTimeDate.day);
+    curTimeDate.hour = (epoch % tickLogSecondsPerDay) / 3600;
+    curTimeDate.minute = (epoch % 3600) / 60;
+}
+
 bool InitSDCard()
 {
     int count = 0;
 
-    Serial.println("Attempting to mount SD card...");
+    LOG_INFO("Attempting to mount SD card...");
 
     while (!SD.begin(chipSelect))
     {
         if (++count > 5)
         {
-            Serial.println("Card Mount Failed.");
+            LOG_ERROR("Card Mount Failed.");
             return false;
         }
         delay(250);
     }
 
-    Serial.println("SD card mounted.");
+    LOG_INFO("SD card mounted.");
+    return true;
+}
+
+bool ParseAlertType(String name, AlertType *type)
+{
+    const char *names[] = {"above", "below", "percent up", "percent down", "rate up", "rate down"};
+    const AlertType types[] = {AlertType::Above, AlertType::Below, AlertType::PercentUp,
+                               AlertType::PercentDown, AlertType::RateUp, AlertType::RateDown};
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (name == names[i])
+        {
+            *type = types[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+Pattern ParseAlertPattern(String name)
+{
+    if (name == "flash")
+    {
+        return Pattern::Flash;
+    }
+    else if (name == "onoff")
+    {
+        return Pattern::OnOff;
+    }
+    return Pattern::Solid;
+}
+
+// Returns the instrument index for a symbol, -1 if not configured.
+int FindInstrument(const char *symbol)
+{
+    for (int i = 0; i < instrumentCount; i++)
+    {
+        if (strcmp(instruments[i].symbol, symbol) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool AddInstrument(const char *symbol, uint8_t priority, int8_t indicator)
+{
+    if (instrumentCount >= MAX_INSTRUMENTS || strlen(symbol) == 0 || strlen(symbol) >= sizeof(Instrument::symbol))
+    {
+        return false;
+    }
+
+    Instrument &instrument = instruments[instrumentCount++];
+    memset(&instrument, 0, sizeof(instrument));
+    strcpy(instrument.symbol, symbol);
+    instrument.priority = max(priority, (uint8_t)1);
+    instrument.indicator = indicator < layout::metalCount ? indicator : -1;
+    return true;
+}
+
+void SetDefaultInstruments()
+{
+    instrumentCount = 0;
+    AddInstrument("XAU", 1, 0);
+    AddInstrument("XAG", 1, 1);
+    AddInstrument("XPT", 1, 2);
+}
+
+// Divide the API call budget across instruments weighted by priority.
+void ScheduleInstruments()
+{
+    if (apiCallsPerHour <= 0)
+    {
+        for (int i = 0; i < instrumentCount; i++)
+        {
+            instruments[i].fetchInterval = 0;
+            LOG_INFO("Instrument: %s, priority: %u, not polled", instruments[i].symbol, instruments[i].priority);
+        }
+        return;
+    }
+
+    int totalPriority = 0;
+    for (int i = 0; i < instrumentCount; i++)
+    {
+        totalPriority += instruments[i].priority;
+    }
+
+    for (int i = 0; i < instrumentCount; i++)
+    {
+        Instrument &instrument = instruments[i];
+        float callsPerHour = (float)apiCallsPerHour * instrument.priority / totalPriority;
+        instrument.fetchInterval = max((uint32_t)(3600000.0 * apiCallsPerFetch / callsPerHour), minFetchInterval);
+
+        LOG_INFO("Instrument: %s, priority: %u, fetch every %u s", instrument.symbol, instrument.priority, instrument.fetchInterval / 1000);
+    }
+}
+
+// Example: "instruments": [{"symbol": "XAU", "priority": "2", "indicator": "0"}, {"symbol": "XPD", "priority": "1"}]
+void LoadInstruments(DynamicJsonDocument &doc)
+{
+    instrumentCount = 0;
+
+    for (JsonObject entry : doc["instruments"].as<JsonArray>())
+    {
+        String symbol = entry["symbol"].as<String>();
+        int indicator = entry["indicator"].isNull() ? -1 : entry["indicator"].as<int>();
+
+        if (!AddInstrument(symbol.c_str(), entry["priority"].as<int>(), indicator))
+        {
+            LOG_WARN("Ignoring instrument: %s", symbol.c_str());
+        }
+    }
+
+    if (instrumentCount == 0)
+    {
+        SetDefaultInstruments();
+    }
+
+    apiCallsPerHour = doc["api calls per hour"].isNull() ? 120 : doc["api calls per hour"].as<int>();
+}
+
+bool AddCurrency(const char *code)
+{
+    if (currencyCount >= MAX_CURRENCIES || strlen(code) != 3)
+    {
+        return false;
+    }
+
+    Currency &currency = currencies[currencyCount++];
+    strcpy(currency.code, code);
+    currency.rate = strcmp(code, "USD") == 0 ? fxRateScale : 0;
     return true;
 }
 
+// Example: "currencies": ["USD", "EUR", "GBP"], default USD only (no FX fetches).
+// A single non-USD currency, e.g. ["EUR"], still needs the FX table.
+void LoadCurrencies(DynamicJsonDocument &doc)
+{
+    currencyCount = 0;
+    selectedCurrency = 0;
+
+    for (JsonVariant entry : doc["currencies"].as<JsonArray>())
+    {
+        String code = entry.as<String>();
+
+        if (!AddCurrency(code.c_str()))
+        {
+            LOG_WARN("Ignoring currency: %s", code.c_str());
+        }
+    }
+
+    if (currencyCount == 0)
+    {
+        AddCurrency("USD");
+    }
+
+    fxUrl = doc["fx url"] | "http://open.er-api.com/v6/latest/USD";
+    fxRefreshInterval = (doc["fx refresh minutes"].isNull() ? 60 : doc["fx refresh minutes"].as<int>()) * 60000UL;
+}
+
+// FX rates are fetched when any configured currency is not USD.
+bool FxRatesNeeded()
+{
+    for (int i = 0; i < currencyCount; i++)
+    {
+        if (strcmp(currencies[i].code, "USD") != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Convert a USD price to a currency in fixed point, 0 if the rate is not known yet.
+float ConvertPrice(float usdPrice, int currency)
+{
+    int64_t price = llround(usdPrice * fxPriceScale);
+    return (float)(price * currencies[currency].rate / fxRateScale) / fxPriceScale;
+}
+
+// The "ssid" / "password" network is tried first, then the "networks" list.
+// Example: "networks": [{"ssid": "Backup", "password": "secret"}]
+void LoadNetworks(DynamicJsonDocument &doc)
+{
+    wifi.addNetwork(ssid, password);
+
+    for (JsonObject entry : doc["networks"].as<JsonArray>())
+    {
+        String networkSsid = entry["ssid"].as<String>();
+
+        if (!wifi.addNetwork(networkSsid, entry["password"].as<String>()))
+        {
+            LOG_WARN("Ignoring network: %s", networkSsid.c_str());
+        }
+    }
+}
+
+// Build alert rules from the percentage keys and the "alerts" list.
+// Example rule: {"instrument": "XAU", "type": "above", "value": "2000", "hysteresis": "5", "pattern": "flash"}
+// Legacy "metal" names (au, ag, pt) and "<metal> alert percentage" keys are still accepted.
+void CompileAlertRules(DynamicJsonDocument &doc)
+{
+    const char *metalKeys[] = {"au", "ag", "pt"};
+    const char *metalSymbols[] = {"XAU", "XAG", "XPT"};
+
+    alerts.clear();
+
+    for (int i = 0; i < 3; i++)
+    {
+        int index = FindInstrument(metalSymbols[i]);
+        float percentage = doc[String(metalKeys[i]) + " alert percentage"].as<float>();
+        if (index >= 0 && percentage > 0)
+        {
+            alerts.addRule(index, AlertType::PercentUp, percentage, percentage / 10, Pattern::Solid);
+            alerts.addRule(index, AlertType::PercentDown, percentage, percentage / 10, Pattern::Solid);
+        }
+    }
+
+    for (JsonObject rule : doc["alerts"].as<JsonArray>())
+    {
+        String symbol = rule["instrument"].as<String>();
+        AlertType type;
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (rule["metal"].as<String>() == metalKeys[i])
+            {
+                symbol = metalSymbols[i];
+            }
+        }
+
+        int index = FindInstrument(symbol.c_str());
+
+        if (index < 0 || !ParseAlertType(rule["type"].as<String>(), &type) ||
+            !alerts.addRule(index, type, rule["value"].as<float>(), rule["hysteresis"].as<float>(),
+                            ParseAlertPattern(rule["pattern"].as<String>())))
+        {
+            LOG_WARN("Ignoring invalid alert rule for: %s", symbol.c_str());
+        }
+    }
+
+    LOG_INFO("Alert rules: %u", alerts.ruleCount());
+}
+
 bool GetParametersFromSDCard()
 {
     File file = SD.open(wifiFilePath);
 
-    Serial.println("Attempting to fetch parameters from SD card...");
+    LOG_INFO("Attempting to fetch parameters from SD card...");
 
     if (!file)
     {
-        Serial.printf("Failed to open file: %s\n", wifiFilePath);
+        LOG_ERROR("Failed to open file: %s", wifiFilePath);
         file.close();
         return false;
     }
     else
     {
-        DynamicJsonDocument doc(2048);
+        DynamicJsonDocument doc(4096);
         DeserializationError error = deserializeJson(doc, file.readString());
 
         if (error)
         {
-            Serial.print(F("DeserializeJson() failed: "));
-            Serial.println(error.c_str());
+            LOG_ERROR("DeserializeJson() failed: %s", error.c_str());
             return false;
         }
 
@@ -214,96 +653,74 @@ bool GetParametersFromSDCard()
         timeZone = doc["time zone"].as<String>();
         brightness = doc["brightness"].as<int>();
         cycleDelay = doc["cycle delay"].as<int>();
-
-        metalSpot[0].percentage = doc["au alert percentage"].as<float>();
-        metalSpot[1].percentage = doc["ag alert percentage"].as<float>();
-        metalSpot[2].percentage = doc["pt alert percentage"].as<float>();
+        powerBudgetMa = doc["power budget ma"].isNull() ? 2000 : doc["power budget ma"].as<int>();
+        streamHost = doc["stream host"].as<String>();
+        streamPort = doc["stream port"].as<int>();
+        streamPath = doc["stream path"].as<String>();
+        shareMode = doc["share mode"].as<String>();
+        shareGroup = doc["share group"] | "239.255.57.57";
+        sharePort = doc["share port"].isNull() ? 5757 : doc["share port"].as<int>();
+
+        LoadNetworks(doc);
+        LoadInstruments(doc);
+        LoadCurrencies(doc);
+        CompileAlertRules(doc);
     }
     file.close();
     return true;
 }
 
+// Split a value into five digits (numbers[0] least significant) and a dot position.
+// Shows as many decimals (2, 1 or 0) as fit, rounding before the split so
+// carries propagate into the integer part (1.996 shows 2.00, not 1.00).
 void GenerateNumbers(float value, int *numbers, int *dot)
 {
-    // Split the value into an integer part and a fractional part.
-    int iPart = (int)value;
-    int fPart = (int)((value - iPart) * 100 + .5);
+    int decimals = 2;
+    long scaled = lround(value * 100);
 
-    int ones = iPart % 10;
-    int tens = (iPart / 10) % 10;
-    int hundreds = (iPart / 100) % 10;
-    int thousands = (iPart / 1000) % 10;
-    int tenthousands = (iPart / 10000);
-
-    int fOnes = fPart % 10;
-    int fTens = (fPart / 10) % 10;
-
-    if (value == 0)
+    while (scaled >= 100000 && decimals > 0)
     {
-        numbers[4] = dashSegment;
-        numbers[3] = dashSegment;
-        numbers[2] = dashSegment;
-        numbers[1] = dashSegment;
-        numbers[0] = dashSegment;
-        *dot = blankSegment;
+        decimals--;
+        scaled = lround(value * (decimals == 1 ? 10 : 1));
     }
-    else if (iPart == 0)
+
+    // No data or out of range, NaN and infinity included.
+    if (!(value > 0 && value < 100000) || scaled >= 100000)
     {
-        numbers[4] = blankSegment;
-        numbers[3] = blankSegment;
-        numbers[2] = blankSegment;
-        numbers[1] = blankSegment;
-        numbers[0] = blankSegment;
+        for (int i = 0; i < 5; i++)
+        {
+            numbers[i] = dashSegment;
+        }
         *dot = blankSegment;
+        return;
     }
-    else if (iPart < 100)
-    {
-        numbers[4] = blankSegment;
-        numbers[3] = tens;
-        numbers[2] = ones;
-        numbers[1] = fTens;
-        numbers[0] = fOnes;
-        *dot = 2;
-    }
-    else if (iPart < 1000)
+
+    for (int i = 0; i < 5; i++)
     {
-        numbers[4] = hundreds;
-        numbers[3] = tens;
-        numbers[2] = ones;
-        numbers[1] = fTens;
-        numbers[0] = fOnes;
-        *dot = 2;
+        numbers[i] = scaled % 10;
+        scaled /= 10;
     }
-    else if (iPart < 10000)
+
+    // Blank leading zeros, always keeping the ones digit.
+    for (int i = 4; i > decimals && numbers[i] == 0; i--)
     {
-        numbers[4] = thousands;
-        numbers[3] = hundreds;
-        numbers[2] = tens;
-        numbers[1] = ones;
-        numbers[0] = fTens;
-        *dot = 3;
-    }
-    else if (iPart < 100000)
-    {
-        numbers[4] = tenthousands;
-        numbers[3] = thousands;
-        numbers[2] = hundreds;
-        numbers[1] = tens;
-        numbers[0] = ones;
-        *dot = blankSegment;
+        numbers[i] = blankSegment;
     }
+
+    // Dots are numbered from the most significant side.
+    *dot = decimals == 0 ? blankSegment : 4 - decimals;
 }
 
 void SetDots(int dot, uint32_t color)
 {
-    for (int i = 0; i < 4; i++)
+    for (int i = 0; i < layout::dotCount; i++)
     {
-        strip2.setPixelColor(i, 0);
+        SetPixel(layout::dots[i], 0);
     }
 
     if (dot != blankSegment)
     {
-        strip2.setPixelColor(dot, SwapRG(color));
+        SetPixel(layout::dots[dot], SwapRG(color));
     }
 }
 
@@ -318,23 +735,21 @@ void SetSegments(int numbers[5], uint32_t color)
     {
         color = Color(0, brightness, 0);
     }
-
-    for (int i = 0; i < 21; i++)
+    else if (color == BLUE)
     {
-        // Segment 1.
-        strip1.setPixelColor(i, decimalToSegmentValues[numbers[4]][i / 3] ? color : 0);
-
-        // Segment 2.
-        strip1.setPixelColor(i + 21, decimalToSegmentValues[numbers[3]][i / 3] ? color : 0);
-
-        // Segment 3.
-        strip2.setPixelColor(i + 5, decimalToSegmentValues[numbers[2]][i / 3] ? color : 0);
+        color = Color(0, 0, brightness);
+    }
 
-        // Segment 4.
-        strip2.setPixelColor(i + 5 + 21, decimalToSegmentValues[numbers[1]][i / 3] ? color : 0);
+    for (int digit = 0; digit < layout::digitCount; digit++)
+    {
+        uint8_t segments = pgm_read_byte(&decimalToSegmentValues[numbers[digit]]);
+        int first = digit * layout::pixelsPerDigit;
 
-        // Segment 5.
-        strip3.setPixelColor(i + 13, decimalToSegmentValues[numbers[0]][i / 3] ? color : 0);
+        for (int i = 0; i < layout::pixelsPerDigit; i++)
+        {
+            bool on = segments & (1 << (i / layout::pixelsPerSegment));
+            SetPixel(layout::segments.pixel[first + i], on ? color : 0);
+        }
     }
 }
 
@@ -349,25 +764,96 @@ void SetIndicators(uint32_t color)
         wheelPos++;
     }
 
-    for (int i = 0; i < 7; i++)
+    for (int i = 0; i < layout::textCount; i++)
     {
-        strip3.setPixelColor(i, Wheel(wheelPos + i * 10));
+        SetPixel(layout::text[i], Wheel(wheelPos + i * 10));
     }
 
     // Set metal indicators;
-    strip3.setPixelColor(7, selectedMetal == 0 ? color : 0);
-    strip3.setPixelColor(8, selectedMetal == 0 ? color : 0);
-    strip3.setPixelColor(9, selectedMetal == 1 ? color : 0);
-    strip3.setPixelColor(10, selectedMetal == 1 ? color : 0);
-    strip3.setPixelColor(11, selectedMetal == 2 ? color : 0);
-    strip3.setPixelColor(12, selectedMetal == 2 ? color : 0);
+    for (int m = 0; m < layout::metalCount; m++)
+    {
+        for (int i = 0; i < layout::pixelsPerMetal; i++)
+        {
+            SetPixel(layout::metals[m][i], instruments[selectedInstrument].indicator == m ? color : 0);
+        }
+    }
+}
+
+// Sum of all channel values in a pixel buffer. Four bytes per step, pairs
+// of bytes accumulate in 16 bit lanes, which cannot overflow for strips up
+// to 512 bytes (170 pixels). Buffers come from malloc, so are word aligned.
+uint32_t SumChannels(const uint8_t *pixels, uint16_t length)
+{
+    const uint32_t *words = (const uint32_t *)pixels;
+    uint32_t lanes = 0;
+    uint16_t i = 0;
+
+    for (; i + 4 <= length; i += 4)
+    {
+        uint32_t word = *words++;
+        lanes += (word & 0x00FF00FF) + ((word >> 8) & 0x00FF00FF);
+    }
+
+    uint32_t sum = (lanes & 0xFFFF) + (lanes >> 16);
+    for (; i < length; i++)
+    {
+        sum += pixels[i];
+    }
+    return sum;
+}
+
+// Scale the composited frame (all strips) down to the power budget.
+void LimitPower()
+{
+    if (powerBudgetMa == 0)
+    {
+        return;
+    }
+
+    uint32_t startMicros = micros();
+    uint32_t sum = 0;
+    uint32_t pixelCount = 0;
+
+    for (int i = 0; i < layout::stripCount; i++)
+    {
+        sum += SumChannels(strips[i]->getPixels(), strips[i]->numPixels() * 3);
+        pixelCount += strips[i]->numPixels();
+    }
+
+    uint32_t idleMa = pixelCount * ledIdleMa;
+    uint32_t estimateMa = idleMa + sum * ledChannelMa / 255;
+
+    powerStats.frames++;
+    powerStats.peakMa = max(powerStats.peakMa, estimateMa);
+
+    if (estimateMa > powerBudgetMa && powerBudgetMa > idleMa)
+    {
+        // Largest channel sum within budget, as a 1/256 scale of the current sum.
+        uint32_t scale = ((powerBudgetMa - idleMa) * 255 / ledChannelMa) * 256 / sum;
+
+        for (int i = 0; i < layout::stripCount; i++)
+        {
+            uint8_t *pixels = strips[i]->getPixels();
+            for (int j = 0; j < strips[i]->numPixels() * 3; j++)
+            {
+                pixels[j] = (pixels[j] * scale) >> 8;
+            }
+        }
+
+        powerStats.limited++;
+    }
+
+    // Timed here, so frames from UpdateConnectionIndicator() count as well.
+    uint32_t elapsed = micros() - startMicros;
+    powerStats.limitMicros += elapsed;
+    powerStats.worstMicros = max(powerStats.worstMicros, elapsed);
 }
 
 void UpdateConnectionIndicator()
 {
     static uint32_t oldIndicatorValue;
 
-    oldIndicatorValue = strip2.getPixelColor(stripStatusIndicatorIndex);
+    oldIndicatorValue = GetPixel(layout::status);
 
     if (indicatorStatus == sdCardFailure)
     {
@@ -378,7 +864,7 @@ void UpdateConnectionIndicator()
             toggle = !toggle;
         }
         uint32_t color = toggle ? YELLOW : OFF;
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(color));
+        SetPixel(layout::status, SwapRG(color));
     }
     else if (indicatorStatus == wifiConnecting)
     {
@@ -389,19 +875,19 @@ void UpdateConnectionIndicator()
             toggle = !toggle;
         }
         uint32_t color = toggle ? RED : OFF;
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(color));
+        SetPixel(layout::status, SwapRG(color));
     }
     else if (indicatorStatus == wifiConnected)
     {
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(GREEN));
+        SetPixel(layout::status, SwapRG(GREEN));
     }
     else if (indicatorStatus == wifiDisconnected)
     {
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(RED));
+        SetPixel(layout::status, SwapRG(RED));
     }
     else if (indicatorStatus == fetchingData)
     {
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(BLUE));
+        SetPixel(layout::status, SwapRG(BLUE));
     }
     else if (indicatorStatus == fetchFailed)
     {
@@ -412,7 +898,7 @@ void UpdateConnectionIndicator()
             toggle = !toggle;
         }
         uint32_t color = toggle ? RED : GREEN;
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(color));
+        SetPixel(layout::status, SwapRG(color));
     }
     else if (indicatorStatus == fetchSuccess)
     {
@@ -423,20 +909,24 @@ void UpdateConnectionIndicator()
             toggle = !toggle;
         }
         uint32_t color = toggle ? GREEN : BLUE;
-        strip2.setPixelColor(stripStatusIndicatorIndex, SwapRG(color));
+        SetPixel(layout::status, SwapRG(color));
     }
 
-    if (oldIndicatorValue != strip2.getPixelColor(stripStatusIndicatorIndex))
+    if (oldIndicatorValue != GetPixel(layout::status))
     {
-        strip2.show();
+        LimitPower();
+        strips[layout::status.strip]->show();
     }
 }
 
 void UpdateStrips()
 {
-    strip1.show();
-    strip2.show();
-    strip3.show();
+    LimitPower();
+
+    for (int i = 0; i < layout::stripCount; i++)
+    {
+        strips[i]->show();
+    }
 }
 
 void sdFailure()
@@ -446,6 +936,7 @@ void sdFailure()
     {
         indicatorStatus = sdCardFailure;
         UpdateConnectionIndicator();
+        Log.drain();
         yield();
     }
 }
@@ -455,26 +946,23 @@ bool UpdateTime()
     String payload;
     String host = "http://worldclockapi.com/api/json/" + timeZone + "/now";
 
-    Serial.print("Connecting to ");
-    Serial.println(host);
+    LOG_INFO("Connecting to %s", host.c_str());
 
     HTTPClient http;
-    http.begin(host);
+    WiFiClient client;
+    http.begin(client, host);
     int httpCode = http.GET();
 
     if (httpCode > 0)
     {
-        Serial.print("HTTP code: ");
-        Serial.println(httpCode);
-        Serial.println("[RESPONSE]");
         payload = http.getString();
-        Serial.println(payload);
+        LOG_INFO("HTTP code: %d, %u bytes", httpCode, payload.length());
+        LOG_DEBUG("%s", payload.c_str());
         http.end();
     }
     else
     {
-        Serial.print("Connection failed, HTTP client code: ");
-        Serial.println(httpCode);
+        LOG_WARN("Connection failed, HTTP client code: %d", httpCode);
         http.end();
         return false;
     }
@@ -484,8 +972,7 @@ bool UpdateTime()
 
     if (error)
     {
-        Serial.print(F("DeserializeJson() failed: "));
-        Serial.println(error.c_str());
+        LOG_ERROR("DeserializeJson() failed: %s", error.c_str());
         return false;
     }
 
@@ -499,40 +986,41 @@ bool UpdateTime()
     curTimeDate.month = dateTime.substring(5, 7).toInt();
     curTimeDate.day = dateTime.substring(8, 10).toInt();
 
-    Serial.printf("Current date: %u:%u:%u\n", curTimeDate.year, curTimeDate.month, curTimeDate.day);
-    Serial.printf("Current time: %u:%u\n", curTimeDate.hour, curTimeDate.minute);
+    timeSyncEpoch = (DaysFromCivil(curTimeDate.year, curTimeDate.month, curTimeDate.day) * tickLogSecondsPerDay) +
+                    (curTimeDate.hour * 3600) + (curTimeDate.minute * 60);
+    timeSyncMillis = millis();
+
+    LOG_INFO("Current date: %u:%u:%u", curTimeDate.year, curTimeDate.month, curTimeDate.day);
+    LOG_INFO("Current time: %u:%u", curTimeDate.hour, curTimeDate.minute);
 
     return true;
 }
 
-bool FetchDataFromInternet(float *price, String expression, String instrument)
-{  
-    const String metals[] = {"XAU", "XAG", "XPT"};
-
+bool FetchDataFromInternet(float *price, String instrument)
+{
     String payload;
-    String host = "https://www.goldapi.io/api/" + instrument + "/USD";
+    String host = "https://" + String(spotApiHost) + "/api/" + instrument + "/USD";
 
-    Serial.print("Connecting to ");
-    Serial.println(host);
+    LOG_INFO("Connecting to %s", host.c_str());
 
-    HTTPClient http;
-    http.begin(host);
+    // Kept between calls so the connection is reused (keep-alive).
+    static HTTPClient http;
+    http.setReuse(true);
+    http.begin(spotClient, host);
     http.addHeader("x-access-token", "goldapi-dbg9uykdhnka38-io");
     int httpCode = http.GET();
+    apiUsage.spotCalls++;
 
     if (httpCode > 0)
     {
-        Serial.print("HTTP code: ");
-        Serial.println(httpCode);
-        Serial.println("[RESPONSE]");
         payload = http.getString();
-        Serial.println(payload);
+        LOG_INFO("HTTP code: %d, %u bytes", httpCode, payload.length());
+        LOG_DEBUG("%s", payload.c_str());
         http.end();
     }
     else
     {
-        Serial.print("Connection failed, HTTP client code: ");
-        Serial.println(httpCode);
+        LOG_WARN("Connection failed, HTTP client code: %d", httpCode);
         http.end();
         return false;
     }
@@ -542,8 +1030,7 @@ bool FetchDataFromInternet(float *price, String expression, String instrument)
 
     if (error)
     {
-        Serial.print(F("DeserializeJson() failed: "));
-        Serial.println(error.c_str());
+        LOG_ERROR("DeserializeJson() failed: %s", error.c_str());
         return false;
     }
 
@@ -552,48 +1039,176 @@ bool FetchDataFromInternet(float *price, String expression, String instrument)
     return true;
 }
 
-bool GetUpdatedSpot()
+// Fetch one rate table (units per USD) for all configured currencies.
+// Expected payload: {"rates": {"EUR": 0.92, "GBP": 0.79, ...}}
+bool FetchFxRates()
 {
-    const String metals[] = {"XAU_USD", "XAG_USD", "XPT_USD"};
+    String payload;
+
+    LOG_INFO("Connecting to %s", fxUrl.c_str());
+
+    HTTPClient http;
+    WiFiClient client;
+    WiFiClientSecure secureClient;
+
+    // Rates are not secret, https is used without certificate checks.
+    if (fxUrl.startsWith("https://"))
+    {
+        secureClient.setInsecure();
+        http.begin(secureClient, fxUrl);
+    }
+    else
+    {
+        http.begin(client, fxUrl);
+    }
+
+    int httpCode = http.GET();
+    apiUsage.fxCalls++;
+
+    if (httpCode > 0)
+    {
+        payload = http.getString();
+        LOG_INFO("HTTP code: %d, %u bytes", httpCode, payload.length());
+        http.end();
+    }
+    else
+    {
+        LOG_WARN("Connection failed, HTTP client code: %d", httpCode);
+        http.end();
+        return false;
+    }
 
-    static int metalIndex = 0;
-    if (++metalIndex > 2)
+    // Keep only the configured currencies, full rate tables are several kB.
+    StaticJsonDocument<256> filter;
+    for (int i = 0; i < currencyCount; i++)
     {
-        metalIndex = 0;
+        filter["rates"][currencies[i].code] = true;
     }
 
+    DynamicJsonDocument doc(512);
+    DeserializationError error = deserializeJson(doc, payload, DeserializationOption::Filter(filter));
+
+    if (error)
+    {
+        LOG_ERROR("DeserializeJson() failed: %s", error.c_str());
+        return false;
+    }
+
+    for (int i = 0; i < currencyCount; i++)
+    {
+        double rate = doc["rates"][currencies[i].code] | 0.0;
+
+        if (rate > 0)
+        {
+            currencies[i].rate = llround(rate * fxRateScale);
+            LOG_INFO("FX: %s %.6f", currencies[i].code, rate);
+        }
+        else if (currencies[i].rate == 0)
+        {
+            LOG_WARN("FX: no rate for %s", currencies[i].code);
+        }
+    }
+
+    return true;
+}
+
+// Returns the instrument most overdue for a fetch started lead milliseconds
+// before its deadline, -1 if none is due. Instruments never fetched go first,
+// instruments that are not polled are never due.
+int NextDueInstrument(uint32_t lead)
+{
+    int due = -1;
+    int32_t mostOverdue = 0;
+
+    for (int i = 0; i < instrumentCount; i++)
+    {
+        if (instruments[i].fetchInterval == 0)
+        {
+            continue;
+        }
+
+        if (!instruments[i].fetched)
+        {
+            return i;
+        }
+
+        int32_t overdue = (int32_t)(millis() + lead - instruments[i].deadlineMillis);
+        if (overdue >= mostOverdue)
+        {
+            mostOverdue = overdue;
+            due = i;
+        }
+    }
+
+    return due;
+}
+
+// A pushed quote (stream or leader clock) counts as a fetch, so polling
+// resumes for an instrument only once its pushed price is a fetch interval old.
+// ageMillis is how long ago the price was received at its source.
+void MarkPushed(Instrument &instrument, uint32_t ageMillis = 0)
+{
+    instrument.fetched = true;
+    instrument.updatedMillis = millis() - ageMillis;
+    instrument.deadlineMillis = instrument.updatedMillis + instrument.fetchInterval;
+}
+
+bool GetUpdatedSpot(int index)
+{
+    Instrument &instrument = instruments[index];
+    String pair = String(instrument.symbol) + "_USD";
     float price;
 
+    // Deadlines stay on a fixed grid so early starts do not raise the call rate.
+    // Failed fetches still count against the API call budget.
+    uint32_t startMillis = millis();
+    if (!instrument.fetched || (int32_t)(startMillis - instrument.deadlineMillis) > (int32_t)instrument.fetchInterval)
+    {
+        instrument.deadlineMillis = startMillis;
+    }
+    instrument.deadlineMillis += instrument.fetchInterval;
+    instrument.fetched = true;
+
     // uint32_t free = system_get_free_heap_size();
-    // Serial.print("\nFree RAM: ");
-    // Serial.println(free);
+    // LOG_DEBUG("Free RAM: %u", free);
 
-    if (!FetchDataFromInternet(&price, "open", metals[metalIndex]))
+    if (!FetchDataFromInternet(&price, pair))
     {
         return false;
     }
 
-    metalSpot[metalIndex].open = price;
+    fetchLatency.add(millis() - startMillis);
 
-    if (!FetchDataFromInternet(&price, "close", metals[metalIndex]))
+    // The API gives the latest price only, the open is the first price of the day.
+    uint32_t day = LocalEpoch() / tickLogSecondsPerDay;
+    if (instrument.open <= 0 || instrument.openDay != day)
     {
-        return false;
+        instrument.open = price;
+        instrument.openDay = day;
     }
 
-    metalSpot[metalIndex].close = price;
+    instrument.updatedMillis = millis();
+    instrument.close = price;
+    alerts.update(index, instrument.open, price, millis());
+    ticks.append(LocalEpoch(), instrument.symbol, price);
 
-    Serial.print(metals[metalIndex] + " | ");
-    Serial.print(("Open : " + (String)metalSpot[metalIndex].open) + ", ");
-    Serial.println(("Close : " + (String)metalSpot[metalIndex].close));
+    LOG_INFO("%s | Open : %.2f, Close : %.2f", instrument.symbol, instrument.open, instrument.close);
 
     return true;
 }
 
-void IncrementMetalSelection()
+// Each instrument is shown in every currency before moving to the next.
+void IncrementInstrumentSelection()
 {
-    if (++selectedMetal > 2)
+    if (++selectedCurrency < currencyCount)
     {
-        selectedMetal = 0;
+        return;
+    }
+    selectedCurrency = 0;
+
+    if (++selectedInstrument >= instrumentCount)
+    {
+        selectedInstrument = 0;
     }
 }
 
@@ -609,98 +1224,365 @@ void UpdateDisplay()
     {
         color = MAGENTA;
     }
-    else
+    else if (alerts.active(selectedInstrument))
     {
-        if (metalSpot[selectedMetal].close + (metalSpot[selectedMetal].close * metalSpot[selectedMetal].percentage) > metalSpot[selectedMetal].open)
-        {
-            color = GREEN;
-        }
-
-        if (metalSpot[selectedMetal].close - (metalSpot[selectedMetal].close * metalSpot[selectedMetal].percentage) < metalSpot[selectedMetal].open)
-        {
-            color = RED;
-        }
+        color = alerts.rising(selectedInstrument) ? GREEN : RED;
     }
 
     // Dots need dimmed due to physical  characteristics of physical LED housings.
     uint32_t dotColor = color == RED ? RED_DIM : color == GREEN ? GREEN_DIM
+                                             : color == BLUE    ? BLUE_DIM
                                              : color == MAGENTA ? MAGENTA_DIM
                                                                 : OFF;
 
-    GenerateNumbers(metalSpot[selectedMetal].close, numbers, &dot);
+    if (alertBlank)
+    {
+        color = OFF;
+        dotColor = OFF;
+    }
+
+    if (instruments[selectedInstrument].updatedMillis)
+    {
+        uint32_t age = millis() - instruments[selectedInstrument].updatedMillis;
+        staleness.count++;
+        staleness.sumMillis += age;
+        staleness.maxMillis = max(staleness.maxMillis, age);
+    }
+
+    uint32_t startMicros = micros();
+
+    GenerateNumbers(ConvertPrice(instruments[selectedInstrument].close, selectedCurrency), numbers, &dot);
     SetSegments(numbers, color);
     SetDots(dot, dotColor);
-    SetIndicators(BLUE);
+    SetIndicators(holdSelection ? YELLOW : currencyColors[selectedCurrency]);
+
+    uint32_t composedMicros = micros();
     UpdateStrips();
+    uint32_t endMicros = micros();
+
+    renderTiming.count++;
+    renderTiming.composeMicros += composedMicros - startMicros;
+    renderTiming.showMicros += endMicros - composedMicros;
+    renderTiming.worstMicros = max(renderTiming.worstMicros, endMicros - startMicros);
 }
 
-void setup()
+// Apply pending ticks from the quote stream, redraw only when the displayed price changes.
+void UpdateFromStream()
 {
-    Serial.begin(74880); // BAUD is default ESP8266 debug BAUD.
+    while (!scheduler.overBudget() && stream.poll())
+    {
+        int i = FindInstrument(stream.symbol());
 
-    Serial.println("Spot Clock 2 starting up...");
+        if (i < 0)
+        {
+            continue;
+        }
 
-    strip1.begin();
-    strip2.begin();
-    strip3.begin();
-    UpdateStrips();
+        MarkPushed(instruments[i]);
 
-    buttonSelect.begin();
+        if (stream.open() > 0)
+        {
+            instruments[i].open = stream.open();
+            instruments[i].openDay = LocalEpoch() / tickLogSecondsPerDay;
+        }
 
-    if (!InitSDCard())
+        if (instruments[i].close != stream.close())
+        {
+            instruments[i].close = stream.close();
+            alerts.update(i, instruments[i].open, instruments[i].close, millis());
+            ticks.append(LocalEpoch(), instruments[i].symbol, instruments[i].close, tickLogSourceStream);
+
+            if (i == selectedInstrument)
+            {
+                UpdateDisplay();
+
+                uint32_t latency = micros() - stream.tickMicros();
+                streamLatency.count++;
+                streamLatency.sumMicros += latency;
+                streamLatency.maxMicros = max(streamLatency.maxMicros, latency);
+                LOG_DEBUG("Read-to-pixel latency: %u us", latency);
+
+                if (stream.hasSentTime())
+                {
+                    uint32_t endToEnd = millis() - stream.sentMillis();
+                    streamLatency.endToEndCount++;
+                    streamLatency.sumEndToEndMillis += endToEnd;
+                    streamLatency.maxEndToEndMillis = max(streamLatency.maxEndToEndMillis, endToEnd);
+                }
+            }
+        }
+    }
+}
+
+// Blink the display while the selected metal has a flashing alert.
+void UpdateAlertFlash()
+{
+    bool blank = false;
+
+    if (alerts.pattern(selectedInstrument) != Pattern::Solid)
     {
-        sdFailure();
+        alertFlasher.setPattern(alerts.pattern(selectedInstrument));
+        blank = alertFlasher.getPwmValue() == 0;
     }
 
-    GetParametersFromSDCard();
+    if (blank != alertBlank)
+    {
+        alertBlank = blank;
+        UpdateDisplay();
+    }
+}
 
-    /*
-   // Development parameters when bypassing SD card.
-    ssid = "RedSky";
-    password = "happyredcat";
-    timeZone = "EST";
-    brightness = 100;
-    cycleDelay = 3000;
-    */
+// Periodic uptime, heap and task trace for long-running (soak) tests.
+// One line per pass while the log has room, so the trace never fills the
+// log buffer and pushes out fetch messages.
+void UpdateHealthTrace()
+{
+    static msTimer timer(60000);
+    static int line = -1; // Next line of the trace in progress, -1 for none.
 
-    Serial.print("SSID: ");
-    Serial.println(ssid);
-    Serial.print("Password: ");
-    Serial.println(password);
-    Serial.print("Time zone: ");
-    Serial.println(timeZone);
-    Serial.printf("Brightness: %u\n", brightness);
-    Serial.printf("CycleDelay: %u\n", cycleDelay);
+    if (timer.elapsed())
+    {
+        line = 0;
+    }
 
-    Serial.print("Connecting to WiFi...");
-    WiFi.begin(ssid, password);
+    if (line < 0 || !Log.room())
+    {
+        return;
+    }
 
-    msTimer timer(250);
-    while (WiFi.status() != WL_CONNECTED)
+    int taskLine = line - 1;
+    int statsLine = line - 1 - scheduler.taskCount();
+    line++;
+
+    if (taskLine < 0)
     {
-        indicatorStatus = wifiConnecting;
-        UpdateConnectionIndicator();
-        Serial.print(".");
-        delay(250);
+        LOG_INFO("Uptime: %lu s, heap: %u, max block: %u, fragmentation: %u%%",
+                 (unsigned long)(millis() / 1000), ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation());
     }
+    else if (taskLine < scheduler.taskCount())
+    {
+        const TaskStats &stats = scheduler.stats(taskLine);
+        LOG_INFO("Task: %s, runs: %u, cpu: %u us, worst slice: %u us, worst latency: %u us, overruns: %u",
+                 stats.name, stats.runs, stats.cpuMicros, stats.worstSliceMicros, stats.worstLatencyMicros, stats.overruns);
 
-    Serial.println();
-    Serial.println("Connected.");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());  
-    Serial.println(WiFi.localIP());  
+        if (taskLine == scheduler.taskCount() - 1)
+        {
+            scheduler.resetStats();
+        }
+    }
+    else if (statsLine == 0)
+    {
+        LOG_INFO("Fetch latency: mean %u ms, p95 %u ms, price age: mean %u ms, max %u ms",
+                 fetchLatency.mean(), fetchLatency.p95(),
+                 staleness.count ? staleness.sumMillis / staleness.count : 0, staleness.maxMillis);
+        staleness = {};
+    }
+    else if (statsLine == 1)
+    {
+        if (streamLatency.count)
+        {
+            LOG_INFO("Stream: %u ticks shown, read-to-pixel: mean %u us, max %u us, end-to-end: mean %u ms, max %u ms",
+                     streamLatency.count, streamLatency.sumMicros / streamLatency.count, streamLatency.maxMicros,
+                     streamLatency.endToEndCount ? streamLatency.sumEndToEndMillis / streamLatency.endToEndCount : 0,
+                     streamLatency.maxEndToEndMillis);
+        }
+        streamLatency = {};
+    }
+    else if (statsLine == 2)
+    {
+        if (pressLatency.count)
+        {
+            LOG_INFO("Input: %u presses, press-to-pixel: mean %u us, max %u us",
+                     pressLatency.count, pressLatency.sumMicros / pressLatency.count, pressLatency.maxMicros);
+        }
+        pressLatency = {};
+    }
+    else if (statsLine == 3)
+    {
+        if (renderTiming.count)
+        {
+            LOG_INFO("Render: %u frames, compose: mean %u us, show: mean %u us, worst %u us",
+                     renderTiming.count, renderTiming.composeMicros / renderTiming.count,
+                     renderTiming.showMicros / renderTiming.count, renderTiming.worstMicros);
+        }
+        renderTiming = {};
+    }
+    else if (statsLine == 4)
+    {
+        LOG_INFO("Power: %u frames, %u limited, peak %u mA, budget %u mA, limit: mean %u us, worst %u us",
+                 powerStats.frames, powerStats.limited, powerStats.peakMa, powerBudgetMa,
+                 powerStats.frames ? powerStats.limitMicros / powerStats.frames : 0, powerStats.worstMicros);
+        powerStats = {};
+    }
+    else if (statsLine == 5)
+    {
+        int displayedPrices = instrumentCount * currencyCount;
+        LOG_INFO("API calls: spot %u, fx %u, %d displayed prices, %.2f calls per displayed price",
+                 apiUsage.spotCalls, apiUsage.fxCalls, displayedPrices,
+                 (float)(apiUsage.spotCalls + apiUsage.fxCalls) / displayedPrices);
+        apiUsage = {};
+    }
+    else if (statsLine == 6)
+    {
+        const WifiStats &wifiStats = wifi.stats();
+        LOG_INFO("WiFi connects: fast %u, full %u, failed attempts %u, lease changes %u",
+                 wifiStats.fastConnects, wifiStats.fullConnects, wifiStats.failedAttempts, wifiStats.leaseChanges);
+    }
+    else
+    {
+        const WifiStats &wifiStats = wifi.stats();
+        LOG_INFO("WiFi connect time (ms): <500: %u, <1000: %u, <2000: %u, <4000: %u, <8000: %u, <16000: %u, more: %u",
+                 wifiStats.histogram[0], wifiStats.histogram[1], wifiStats.histogram[2], wifiStats.histogram[3],
+                 wifiStats.histogram[4], wifiStats.histogram[5], wifiStats.histogram[6]);
+        line = -1;
+    }
 }
 
-void loop()
+// Leader: multicast the current quotes and time.
+void ShareQuotes()
 {
-    // Check for WiFi status change.
+    ShareQuote *quotes = share.quotes();
+    int count = min(instrumentCount, SHARE_MAX_QUOTES);
+
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(quotes[i].symbol, instruments[i].symbol, sizeof(quotes[i].symbol));
+        quotes[i].open = lround(instruments[i].open * sharePriceScale);
+        quotes[i].close = lround(instruments[i].close * sharePriceScale);
+        quotes[i].ageMillis = millis() - instruments[i].updatedMillis;
+    }
+
+    if (!share.send(LocalEpoch(), count))
+    {
+        LOG_WARN("Quote share send failed.");
+    }
+}
+
+// Follower: apply snapshots from the leader.
+void ReceiveSharedQuotes()
+{
+    while (!scheduler.overBudget() && share.receive())
+    {
+        if (share.header().epoch)
+        {
+            SetTimeFromEpoch(share.header().epoch);
+        }
+
+        for (int q = 0; q < share.header().count; q++)
+        {
+            const ShareQuote &quote = share.quotes()[q];
+            int i = FindInstrument(quote.symbol);
+
+            if (i < 0 || quote.close <= 0)
+            {
+                continue;
+            }
+
+            // Not older than a price fetched here while the leader's fetches failed.
+            if (instruments[i].updatedMillis &&
+                (int32_t)(millis() - quote.ageMillis - instruments[i].updatedMillis) < 0)
+            {
+                continue;
+            }
+
+            float close = (float)quote.close / sharePriceScale;
+            instruments[i].open = (float)quote.open / sharePriceScale;
+            instruments[i].openDay = LocalEpoch() / tickLogSecondsPerDay;
+            MarkPushed(instruments[i], quote.ageMillis);
+
+            if (instruments[i].close != close)
+            {
+                instruments[i].close = close;
+                alerts.update(i, instruments[i].open, close, millis());
+                ticks.append(LocalEpoch(), instruments[i].symbol, close, tickLogSourceShare);
+
+                if (i == selectedInstrument)
+                {
+                    UpdateDisplay();
+                }
+            }
+        }
+    }
+}
+
+// Press selects the next instrument, long press holds/releases the selection
+// (metal indicators turn yellow while held).
+void ServiceInput()
+{
+    ButtonEvent event;
+
+    while (buttonSelect.read(&event))
+    {
+        if (event.type == ButtonEventType::Press)
+        {
+            timerInstrumentSelection.resetDelay();
+            IncrementInstrumentSelection();
+            UpdateDisplay();
+
+            uint32_t latency = micros() - event.micros;
+            pressLatency.count++;
+            pressLatency.sumMicros += latency;
+            pressLatency.maxMicros = max(pressLatency.maxMicros, latency);
+            LOG_DEBUG("Press-to-pixel latency: %u us", latency);
+        }
+        else if (event.type == ButtonEventType::LongPress)
+        {
+            holdSelection = !holdSelection;
+            UpdateDisplay();
+        }
+    }
+}
+
+void InputTask()
+{
+    ServiceInput();
+}
+
+void RenderTask()
+{
+    // Automatically change instrument selection on elasped timer.
+    if (timerInstrumentSelection.elapsed())
+    {
+        if (!holdSelection)
+        {
+            IncrementInstrumentSelection();
+            UpdateDisplay();
+        }
+    }
+
+    // Update alert flash pattern.
+    UpdateAlertFlash();
+
+    // Update status indicator.
+    UpdateConnectionIndicator();
+}
+
+// Coroutine, yields between the blocking time and spot fetches.
+void NetworkTask()
+{
+    static msTimer timerFetch(0);
+    static msTimer timerFx(0);
+    static bool fxLoaded;
     static wl_status_t previousWifiStatus = WL_NO_SHIELD;
+    static bool timeDue;
+    static bool fxDue;
+    static int instrumentDue;
+    static int warmedFor = -1;
+    static bool success;
+
+    TASK_BEGIN();
+
+    // Reconnect when the connection drops.
+    wifi.update();
+
+    // Check for WiFi status change.
     if (previousWifiStatus != WiFi.status())
     {
         previousWifiStatus = WiFi.status();
         if (WiFi.status() == WL_CONNECTED)
         {
             indicatorStatus = wifiConnected;
+            LOG_INFO("WiFi connected to %s in %u ms", wifi.ssid(), wifi.stats().lastConnectMillis);
         }
         else if (WiFi.status() != WL_CONNECTED)
         {
@@ -708,9 +1590,33 @@ void loop()
         }
     }
 
-    // Update spot values on timer.
-    static msTimer timerFetch(0);
-    if (timerFetch.elapsed())
+    // Followers take quotes and time from the leader while it is heard.
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        ReceiveSharedQuotes();
+    }
+
+    // Update time on timer and spot values when an instrument is due.
+    // Instruments kept fresh by the stream or the leader are not due.
+    timeDue = !share.leaderAlive() && timerFetch.elapsed();
+    instrumentDue = NextDueInstrument(fetchLatency.leadTime());
+    fxDue = FxRatesNeeded() && WiFi.status() == WL_CONNECTED && timerFx.elapsed();
+
+    // Open the spot API connection shortly before a fetch starts, unless it is still open.
+    if (instrumentDue < 0 && WiFi.status() == WL_CONNECTED)
+    {
+        int dueSoon = NextDueInstrument(fetchLatency.leadTime() + connectWarmLead);
+        if (dueSoon >= 0 && dueSoon != warmedFor)
+        {
+            if (!spotClient.connected())
+            {
+                spotClient.connect(spotApiHost, spotApiPort);
+            }
+            warmedFor = dueSoon;
+        }
+    }
+
+    if (timeDue || instrumentDue >= 0 || fxDue)
     {
         if (WiFi.status() == WL_CONNECTED)
         {
@@ -719,41 +1625,155 @@ void loop()
             indicatorStatus = fetchingData;
             UpdateConnectionIndicator();
 
-            bool success = false;
-            success = UpdateTime();
-            success = success | GetUpdatedSpot();
+            success = true;
+            if (timeDue)
+            {
+                success = UpdateTime();
+                TASK_YIELD();
+            }
+            if (fxDue)
+            {
+                if (FetchFxRates())
+                {
+                    fxLoaded = true;
+                }
+                else
+                {
+                    success = false;
+                }
+
+                // Other currencies have no rate until a first table arrives, retry soon until then.
+                timerFx.setDelayAndReset(fxLoaded ? fxRefreshInterval : fxRetryInterval);
+                TASK_YIELD();
+            }
+            if (instrumentDue >= 0)
+            {
+                success = GetUpdatedSpot(instrumentDue) && success;
+                warmedFor = -1;
+            }
             indicatorStatus = success ? wifiConnected : fetchFailed;
 
             UpdateDisplay();
+
+            if (share.mode() == ShareMode::Leader)
+            {
+                ShareQuotes();
+            }
         }
     }
 
-    // Automatically change metal selection on elasped timer.
-    static msTimer timerMetalSelection(cycleDelay);
-    static bool holdFlag = false;
-    if (timerMetalSelection.elapsed())
+    // Leader heartbeat, lets followers know the leader is alive between fetches.
+    if (share.heartbeatDue() && WiFi.status() == WL_CONNECTED)
     {
-        if (!holdFlag)
-        {
-            IncrementMetalSelection();
-            UpdateDisplay();
-        }
+        ShareQuotes();
     }
 
-    // Change metal selection on pressed select button.
-    buttonSelect.read();
-    if (buttonSelect.wasPressed())
+    // Apply streamed ticks as they arrive.
+    if (WiFi.status() == WL_CONNECTED)
     {
-        timerMetalSelection.resetDelay();
-        IncrementMetalSelection();
-        UpdateDisplay();
+        UpdateFromStream();
     }
-    if (buttonSelect.pressedFor(1000))
+
+    TASK_END();
+}
+
+void HousekeepingTask()
+{
+    // Write partially filled tick log block.
+    ticks.update();
+
+    // Trace health.
+    UpdateHealthTrace();
+
+    // Write pending log messages from idle time.
+    Log.drain();
+}
+
+void setup()
+{
+    Serial.begin(74880); // BAUD is default ESP8266 debug BAUD.
+    Log.begin(Serial);
+
+    LOG_INFO("Spot Clock 2 starting up...");
+
+    for (int i = 0; i < layout::stripCount; i++)
     {
-        // TODO: indicate to the user that a hold is placed/removed.
-        holdFlag = !holdFlag;
+        strips[i]->begin();
     }
+    UpdateStrips();
 
-    // Update status indicator.
-    UpdateConnectionIndicator();
-}
\ No newline at end of file
+    buttonSelect.begin();
+    alertFlasher.reset();
+
+    if (!InitSDCard())
+    {
+        sdFailure();
+    }
+
+    GetParametersFromSDCard();
+
+    if (instrumentCount == 0)
+    {
+        SetDefaultInstruments();
+    }
+    ScheduleInstruments();
+
+    if (!ticks.begin())
+    {
+        LOG_WARN("Tick log unavailable.");
+    }
+
+    /*
+   // Development parameters when bypassing SD card.
+    ssid = "RedSky";
+    password = "happyredcat";
+    timeZone = "EST";
+    brightness = 100;
+    cycleDelay = 3000;
+    */
+
+    LOG_INFO("SSID: %s", ssid.c_str());
+    LOG_INFO("Password: %s", Redact(password));
+    LOG_INFO("Time zone: %s", timeZone.c_str());
+    LOG_INFO("Brightness: %u", brightness);
+    LOG_INFO("CycleDelay: %u", cycleDelay);
+    LOG_INFO("Power budget: %u mA", powerBudgetMa);
+    timerInstrumentSelection.setDelayAndReset(cycleDelay);
+    LOG_INFO("Stream: %s:%d%s", streamHost.length() ? streamHost.c_str() : "disabled", streamPort, streamPath.c_str());
+
+    stream.begin(streamHost, streamPort, streamPath);
+
+    // There is no certificate store on the device, the spot API is used over
+    // https without certificate checks, as the FX API.
+    spotClient.setInsecure();
+
+    IPAddress group;
+    group.fromString(shareGroup.c_str());
+    share.begin(shareMode == "leader" ? ShareMode::Leader : shareMode == "follower" ? ShareMode::Follower : ShareMode::Off,
+                group, sharePort);
+    LOG_INFO("Share: %s, %s:%d", shareMode.length() ? shareMode.c_str() : "off", shareGroup.c_str(), sharePort);
+
+    LOG_INFO("Connecting to WiFi (%u networks)...", wifi.networkCount());
+    wifi.begin();
+
+    while (!wifi.update())
+    {
+        indicatorStatus = wifiConnecting;
+        UpdateConnectionIndicator();
+        Log.drain();
+        delay(10);
+    }
+
+    LOG_INFO("Connected to %s in %u ms, IP address: %s", wifi.ssid(), wifi.stats().lastConnectMillis, WiFi.localIP().toString().c_str());
+
+    // Name, function, priority, period (ms), slice budget (us).
+    scheduler.add("input", InputTask, 3, 0, 2000);
+    scheduler.add("render", RenderTask, 2, 0, 10000);
+    scheduler.add("network", NetworkTask, 1, 0, 20000);
+    scheduler.add("housekeeping", HousekeepingTask, 0, 10, 5000);
+}
+
+void loop()
+{
+    scheduler.run();
+}
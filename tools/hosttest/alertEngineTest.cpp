@@ -0,0 +1,145 @@
+// Alert engine tests: rule grouping with several rules per instrument,
+// hysteresis and rate rules.
+
+#include "hostTest.h"
+#include "alertEngine.h"
+
+// Default SD card rules: percentage up/down per metal, plus extra rules.
+static void addDefaultRules(alertEngine &alerts)
+{
+    alerts.addRule(0, AlertType::PercentUp, 1, 0.1, Pattern::Solid);
+    alerts.addRule(0, AlertType::PercentDown, 1, 0.1, Pattern::Solid);
+    alerts.addRule(1, AlertType::PercentUp, 2, 0.2, Pattern::Solid);
+    alerts.addRule(1, AlertType::PercentDown, 2, 0.2, Pattern::Solid);
+    alerts.addRule(2, AlertType::PercentUp, 1, 0.1, Pattern::Solid);
+    alerts.addRule(2, AlertType::PercentDown, 1, 0.1, Pattern::Solid);
+}
+
+TEST(percentUpTriggersWithSeveralRulesPerInstrument)
+{
+    alertEngine alerts;
+    addDefaultRules(alerts);
+    CHECK_EQ(alerts.ruleCount(), 6);
+
+    // +1.5% on the first instrument.
+    CHECK(alerts.update(0, 2000, 2030, 1000));
+    CHECK(alerts.active(0));
+    CHECK(alerts.rising(0));
+
+    // Below the 2% threshold of the second instrument, must not trigger.
+    CHECK(!alerts.update(1, 2000, 2030, 1000));
+    CHECK(!alerts.active(1));
+}
+
+TEST(eachRuleOnlySeesItsInstrument)
+{
+    alertEngine alerts;
+    addDefaultRules(alerts);
+
+    // -1.5% on every instrument, only the 1% rules trigger.
+    alerts.update(0, 100, 98.5, 1000);
+    alerts.update(1, 100, 98.5, 1000);
+    alerts.update(2, 100, 98.5, 1000);
+
+    CHECK(alerts.active(0) && !alerts.rising(0));
+    CHECK(!alerts.active(1));
+    CHECK(alerts.active(2) && !alerts.rising(2));
+}
+
+TEST(rulesAddedOutOfOrderStayGrouped)
+{
+    alertEngine alerts;
+
+    alerts.addRule(2, AlertType::Above, 1000, 5, Pattern::Flash);
+    alerts.addRule(0, AlertType::Above, 2000, 5, Pattern::OnOff);
+    alerts.addRule(2, AlertType::Below, 900, 5, Pattern::Solid);
+    alerts.addRule(0, AlertType::Below, 1900, 5, Pattern::Solid);
+    alerts.addRule(1, AlertType::Above, 30, 1, Pattern::Solid);
+    alerts.addRule(0, AlertType::PercentUp, 50, 1, Pattern::Solid);
+
+    alerts.update(0, 0, 1850, 1000);
+    alerts.update(1, 0, 25, 1000);
+    alerts.update(2, 0, 1010, 1000);
+
+    CHECK(alerts.active(0) && !alerts.rising(0));
+    CHECK(!alerts.active(1));
+    CHECK(alerts.active(2) && alerts.pattern(2) == Pattern::Flash);
+
+    alerts.update(0, 0, 2010, 2000);
+    CHECK(alerts.active(0) && alerts.rising(0) && alerts.pattern(0) == Pattern::OnOff);
+    alerts.update(1, 0, 31, 2000);
+    CHECK(alerts.active(1));
+    alerts.update(2, 0, 890, 2000);
+    CHECK(alerts.active(2) && !alerts.rising(2));
+}
+
+TEST(firstRuleInConfigurationOrderWins)
+{
+    alertEngine alerts;
+    alerts.addRule(0, AlertType::Above, 2000, 5, Pattern::Flash);
+    alerts.addRule(0, AlertType::Above, 1900, 5, Pattern::OnOff);
+
+    alerts.update(0, 0, 2050, 1000);
+    CHECK(alerts.pattern(0) == Pattern::Flash);
+
+    alerts.update(0, 0, 1950, 2000);
+    CHECK(alerts.pattern(0) == Pattern::OnOff);
+}
+
+TEST(hysteresisHoldsUntilRelease)
+{
+    alertEngine alerts;
+    alerts.addRule(0, AlertType::Above, 2000, 10, Pattern::Solid);
+
+    CHECK(alerts.update(0, 0, 2000, 1000));
+    CHECK(!alerts.update(0, 0, 1995, 2000));
+    CHECK(alerts.active(0));
+    CHECK(alerts.update(0, 0, 1989, 3000));
+    CHECK(!alerts.active(0));
+}
+
+TEST(rateRulesUseTimeBetweenUpdates)
+{
+    alertEngine alerts;
+    alerts.addRule(0, AlertType::RateDown, 0.5, 0.1, Pattern::Solid);
+
+    alerts.update(0, 0, 100, 0);
+    // -1% in two minutes is -0.5% per minute.
+    alerts.update(0, 0, 99, 120000);
+    CHECK(alerts.active(0));
+
+    // Flat for a minute.
+    alerts.update(0, 0, 99, 180000);
+    CHECK(!alerts.active(0));
+}
+
+TEST(clearResetsRateState)
+{
+    alertEngine alerts;
+    alerts.addRule(0, AlertType::RateUp, 1, 0.1, Pattern::Solid);
+    alerts.update(0, 0, 100, 0);
+
+    alerts.clear();
+    CHECK_EQ(alerts.ruleCount(), 0);
+    alerts.addRule(0, AlertType::RateUp, 1, 0.1, Pattern::Solid);
+
+    // First price after clear has no previous price or time to compare with.
+    alerts.update(0, 0, 200, 60000);
+    CHECK(!alerts.active(0));
+}
+
+TEST(rejectsRulesBeyondLimits)
+{
+    alertEngine alerts;
+    for (int i = 0; i < ALERT_MAX_RULES; i++)
+    {
+        CHECK(alerts.addRule(i % 3, AlertType::Above, 1000 + i, 1, Pattern::Solid));
+    }
+    CHECK(!alerts.addRule(0, AlertType::Above, 5000, 1, Pattern::Solid));
+    CHECK(!alerts.addRule(ALERT_MAX_INSTRUMENTS, AlertType::Above, 5000, 1, Pattern::Solid));
+}
+
+int main()
+{
+    return hostTest::run();
+}
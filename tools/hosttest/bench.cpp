@@ -0,0 +1,278 @@
+// Host microbenchmarks for the firmware's pure helpers
+//
+// Each benchmark runs in batches of a fixed wall time, interleaved over
+// several rounds, and reports the best ns per call. Results are compared
+// against a stored baseline after normalising both by the "reference"
+// call, so a baseline recorded on one machine still catches regressions
+// on another.
+//
+//   bench                          Print ns per call.
+//   bench --baseline FILE [--tolerance PERCENT]
+//                                  Also compare, exit 1 on a regression.
+//   bench --write FILE             Store the results as the new baseline.
+
+#include "flasher.h"
+#include <chrono>
+#include <map>
+#include <string>
+
+// From firmware/src/main.cpp.
+void GenerateNumbers(float value, int *numbers, int *dot);
+int dayofweek(int d, int m, int y);
+uint32_t Color(uint8_t r, uint8_t g, uint8_t b);
+uint32_t Wheel(byte WheelPos);
+uint32_t SwapRG(uint32_t color);
+
+// Keeps results alive without letting the compiler see through them.
+static volatile uint32_t sink;
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)(uint32_t calls);
+};
+
+// A trivial out of line call, the same loop, call and store overhead as
+// the benchmarks below. Scales results between machines.
+__attribute__((noinline)) static uint32_t referenceCall(uint32_t x)
+{
+    __asm__ volatile("");
+    return x * 0x9E3779B9u;
+}
+
+static void reference(uint32_t calls)
+{
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sink = referenceCall(i);
+    }
+}
+
+// Prices spread over every precision the formatter picks.
+static const float prices[] = {0.5f, 1.996f, 27.35f, 999.996f, 1834.27f, 9999.96f, 24567.8f, 99999.6f};
+
+static void generateNumbers(uint32_t calls)
+{
+    int numbers[5];
+    int dot;
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        GenerateNumbers(prices[i & 7], numbers, &dot);
+        sink = numbers[0] + dot;
+    }
+}
+
+static void dayOfWeek(uint32_t calls)
+{
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sink = dayofweek(1 + i % 28, 1 + i % 12, 2000 + (i & 63));
+    }
+}
+
+static void color(uint32_t calls)
+{
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sink = Color(i, i >> 8, i >> 16);
+    }
+}
+
+static void wheel(uint32_t calls)
+{
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sink = Wheel(i);
+    }
+}
+
+static void swapRG(uint32_t calls)
+{
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sink = SwapRG(i * 0x9E3779B9u);
+    }
+}
+
+// One pattern update per call, the virtual clock moves 50 us per call.
+template <Pattern pattern>
+static void flasherPattern(uint32_t calls)
+{
+    static flasher f(pattern, 1000, 255);
+    static bool started = false;
+    if (!started)
+    {
+        f.reset();
+        started = true;
+    }
+
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        host::nowMicros += 50;
+        sink = f.getPwmValue();
+    }
+}
+
+static const Benchmark benchmarks[] = {
+    {"reference", reference},
+    {"GenerateNumbers", generateNumbers},
+    {"dayofweek", dayOfWeek},
+    {"Color", color},
+    {"Wheel", wheel},
+    {"SwapRG", swapRG},
+    {"flasher.Solid", flasherPattern<Pattern::Solid>},
+    {"flasher.OnOff", flasherPattern<Pattern::OnOff>},
+    {"flasher.Sin", flasherPattern<Pattern::Sin>},
+    {"flasher.RampUp", flasherPattern<Pattern::RampUp>},
+    {"flasher.Flash", flasherPattern<Pattern::Flash>},
+    {"flasher.RandomFlash", flasherPattern<Pattern::RandomFlash>},
+    {"flasher.RandomReverseFlash", flasherPattern<Pattern::RandomReverseFlash>},
+};
+
+// Best of several 10 ms batches, in ns per call.
+static double measure(const Benchmark &benchmark)
+{
+    typedef std::chrono::steady_clock clock;
+    const double batchNanos = 10e6;
+    const int batches = 7;
+
+    // Size a batch to roughly 10 ms.
+    uint32_t calls = 1000;
+    while (true)
+    {
+        clock::time_point start = clock::now();
+        benchmark.run(calls);
+        double nanos = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if (nanos > batchNanos / 4 || calls > (1u << 30))
+        {
+            calls = std::max(1.0, calls * batchNanos / std::max(nanos, 1.0));
+            break;
+        }
+        calls *= 4;
+    }
+
+    double best = 1e30;
+    for (int i = 0; i < batches; i++)
+    {
+        clock::time_point start = clock::now();
+        benchmark.run(calls);
+        best = std::min(best, std::chrono::duration<double, std::nano>(clock::now() - start).count() / calls);
+    }
+    return best;
+}
+
+static std::map<std::string, double> readBaseline(const char *path)
+{
+    std::map<std::string, double> baseline;
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot read baseline %s\n", path);
+        exit(2);
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        char name[128];
+        double nanos;
+        if (line[0] != '#' && sscanf(line, "%127s %lf", name, &nanos) == 2)
+        {
+            baseline[name] = nanos;
+        }
+    }
+    fclose(file);
+    return baseline;
+}
+
+int main(int argc, char **argv)
+{
+    const char *baselinePath = nullptr;
+    const char *writePath = nullptr;
+    double tolerance = 30;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--baseline") == 0)
+        {
+            baselinePath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--write") == 0)
+        {
+            writePath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0)
+        {
+            tolerance = atof(argv[i + 1]);
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath)
+    {
+        baseline = readBaseline(baselinePath);
+    }
+
+    // Interleaved rounds, so a slow spell on the host does not hit one
+    // benchmark only.
+    std::map<std::string, double> results;
+    for (int round = 0; round < 5; round++)
+    {
+        for (const Benchmark &benchmark : benchmarks)
+        {
+            double nanos = measure(benchmark);
+            results[benchmark.name] = round ? std::min(results[benchmark.name], nanos) : nanos;
+        }
+    }
+
+    double scale = baseline.count("reference") ? baseline["reference"] / results["reference"] : 1;
+    int regressions = 0;
+
+    printf("%-28s %10s %10s %8s\n", "benchmark", "ns/call", "baseline", "change");
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        double &nanos = results[benchmark.name];
+
+        if (baseline.count(benchmark.name) && benchmark.run != reference)
+        {
+            // Compare in baseline machine time, measure again before
+            // reporting a regression in case the host was busy.
+            double change = (nanos * scale / baseline[benchmark.name] - 1) * 100;
+            for (int retry = 0; retry < 3 && change > tolerance; retry++)
+            {
+                nanos = std::min(nanos, measure(benchmark));
+                change = (nanos * scale / baseline[benchmark.name] - 1) * 100;
+            }
+            bool regressed = change > tolerance;
+            regressions += regressed;
+            printf("%-28s %10.2f %10.2f %+7.1f%%%s\n", benchmark.name, nanos, baseline[benchmark.name], change,
+                   regressed ? "  REGRESSION" : "");
+        }
+        else
+        {
+            printf("%-28s %10.2f\n", benchmark.name, nanos);
+        }
+    }
+
+    if (writePath)
+    {
+        FILE *file = fopen(writePath, "w");
+        if (!file)
+        {
+            fprintf(stderr, "Cannot write baseline %s\n", writePath);
+            return 2;
+        }
+        fprintf(file, "# Host benchmark baseline, ns per call. Update with: make bench-baseline\n");
+        for (const Benchmark &benchmark : benchmarks)
+        {
+            fprintf(file, "%s %.2f\n", benchmark.name, results[benchmark.name]);
+        }
+        fclose(file);
+    }
+
+    if (baselinePath)
+    {
+        printf("%d regressions over %.0f%% (machine scale %.2f)\n", regressions, tolerance, scale);
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+// Button event tests: debouncing from the edge timestamps, including
+// whole presses that happen while the loop is blocked.
+
+#include "hostTest.h"
+#include "buttonEvents.h"
+#include <vector>
+
+const uint8_t pin = 2;
+
+struct Event
+{
+    ButtonEventType type;
+    uint32_t millis;
+};
+
+// Released button, debounce 25 ms, long press 1000 ms, at t = 0.
+static buttonEvents &freshButton()
+{
+    static buttonEvents *button = nullptr;
+    delete button;
+
+    host::setMillis(0);
+    host::setPin(pin, HIGH);
+    button = new buttonEvents(pin, 25, 1000);
+    button->begin();
+    return *button;
+}
+
+// Pin level at a time in milliseconds, LOW is pressed.
+static void edge(uint32_t millis, int level)
+{
+    host::setMillis(millis);
+    host::setPin(pin, level);
+}
+
+static std::vector<Event> readAt(buttonEvents &button, uint32_t millis)
+{
+    host::setMillis(millis);
+
+    std::vector<Event> events;
+    ButtonEvent event;
+    while (button.read(&event) && events.size() < 10)
+    {
+        events.push_back({event.type, event.micros / 1000});
+    }
+    return events;
+}
+
+TEST(pressAndReleaseDuringABlockedLoopGiveBothEvents)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+    edge(300, HIGH);
+
+    std::vector<Event> events = readAt(button, 2000);
+    CHECK_EQ(events.size(), 2u);
+    if (events.size() == 2)
+    {
+        CHECK(events[0].type == ButtonEventType::Press);
+        CHECK_EQ(events[0].millis, 100u);
+        CHECK(events[1].type == ButtonEventType::Release);
+        CHECK_EQ(events[1].millis, 300u);
+    }
+    CHECK(!button.pressed());
+}
+
+TEST(longPressDuringABlockedLoopKeepsEventOrder)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+    edge(1500, HIGH);
+
+    std::vector<Event> events = readAt(button, 3000);
+    CHECK_EQ(events.size(), 3u);
+    if (events.size() == 3)
+    {
+        CHECK(events[0].type == ButtonEventType::Press);
+        CHECK(events[1].type == ButtonEventType::LongPress);
+        CHECK_EQ(events[1].millis, 1100u);
+        CHECK(events[2].type == ButtonEventType::Release);
+        CHECK_EQ(events[2].millis, 1500u);
+    }
+}
+
+TEST(bouncesAreOneChangeFromTheFirstEdge)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+    edge(101, HIGH);
+    edge(103, LOW);
+    edge(110, HIGH);
+    edge(112, LOW);
+
+    // Not settled yet.
+    CHECK(readAt(button, 130).empty());
+
+    std::vector<Event> events = readAt(button, 140);
+    CHECK_EQ(events.size(), 1u);
+    if (events.size() == 1)
+    {
+        CHECK(events[0].type == ButtonEventType::Press);
+        CHECK_EQ(events[0].millis, 100u);
+    }
+    CHECK(button.pressed());
+}
+
+TEST(glitchShorterThanDebounceIsIgnored)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+    edge(110, HIGH);
+
+    CHECK(readAt(button, 500).empty());
+    CHECK(!button.pressed());
+}
+
+TEST(severalPressesDuringABlockedLoop)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+    edge(200, HIGH);
+    edge(300, LOW);
+    edge(302, HIGH); // Bounce.
+    edge(304, LOW);
+    edge(400, HIGH);
+
+    std::vector<Event> events = readAt(button, 1000);
+    CHECK_EQ(events.size(), 4u);
+    if (events.size() == 4)
+    {
+        CHECK(events[0].type == ButtonEventType::Press && events[0].millis == 100);
+        CHECK(events[1].type == ButtonEventType::Release && events[1].millis == 200);
+        CHECK(events[2].type == ButtonEventType::Press && events[2].millis == 300);
+        CHECK(events[3].type == ButtonEventType::Release && events[3].millis == 400);
+    }
+}
+
+TEST(livePressIsReportedOnceSettled)
+{
+    buttonEvents &button = freshButton();
+    edge(100, LOW);
+
+    CHECK(readAt(button, 110).empty());
+
+    std::vector<Event> events = readAt(button, 126);
+    CHECK_EQ(events.size(), 1u);
+    CHECK(button.pressed());
+
+    events = readAt(button, 1200);
+    CHECK_EQ(events.size(), 1u);
+    CHECK(events.size() == 1 && events[0].type == ButtonEventType::LongPress);
+    CHECK(readAt(button, 1300).empty());
+}
+
+TEST(droppedEdgesResyncToThePinLevel)
+{
+    buttonEvents &button = freshButton();
+
+    // More edges than the queue holds, ending pressed.
+    uint32_t t = 100;
+    for (int i = 0; i < BUTTON_EDGE_QUEUE_SIZE + 5; i++)
+    {
+        edge(t++, i % 2 ? HIGH : LOW);
+    }
+    edge(t, LOW);
+    CHECK(button.overflows() > 0);
+
+    std::vector<Event> events = readAt(button, 500);
+    CHECK(!events.empty() && events.back().type == ButtonEventType::Press);
+    CHECK(button.pressed());
+
+    edge(600, HIGH);
+    events = readAt(button, 700);
+    CHECK(events.size() == 1 && events[0].type == ButtonEventType::Release);
+    CHECK(!button.pressed());
+}
+
+int main()
+{
+    return hostTest::run();
+}
@@ -0,0 +1,475 @@
+// Property and fuzz tests for the firmware's pure helpers: the price
+// formatter, day of week, colour packing, every flasher pattern and
+// msTimer across the millis() rollover.
+
+#include "hostTest.h"
+#include "flasher.h"
+#include "msTimer.h"
+#include "tickLogFormat.h"
+#include <Adafruit_NeoPixel.h>
+
+// From firmware/src/main.cpp.
+void GenerateNumbers(float value, int *numbers, int *dot);
+int dayofweek(int d, int m, int y);
+uint32_t Color(uint8_t r, uint8_t g, uint8_t b);
+uint32_t Wheel(byte WheelPos);
+uint32_t SwapRG(uint32_t color);
+
+// Segment codes, as in main.cpp.
+const int blank = 10;
+const int dash = 11;
+
+static bool allDashes(const int numbers[5], int dot)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        if (numbers[i] != dash)
+        {
+            return false;
+        }
+    }
+    return dot == blank;
+}
+
+// Rebuild the shown value, -1 if the digits are not a valid display.
+static double shownValue(const int numbers[5], int dot)
+{
+    int decimals = dot == blank ? 0 : 4 - dot;
+    if (decimals < 0 || decimals > 2)
+    {
+        return -1;
+    }
+
+    double value = 0;
+    bool leading = true;
+    for (int i = 4; i >= 0; i--)
+    {
+        if (numbers[i] == blank)
+        {
+            // Only leading zeros above the ones digit are blanked.
+            if (!leading || i <= decimals)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (numbers[i] < 0 || numbers[i] > 9 || (leading && numbers[i] == 0 && i > decimals))
+        {
+            return -1;
+        }
+        leading = false;
+        value = value * 10 + numbers[i];
+    }
+    return value / pow(10, decimals);
+}
+
+static void checkDigits(float value, const int (&expected)[5], int expectedDot)
+{
+    int numbers[5];
+    int dot;
+    GenerateNumbers(value, numbers, &dot);
+
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK_EQ(numbers[i], expected[i]);
+    }
+    CHECK_EQ(dot, expectedDot);
+}
+
+TEST(formatterEdgeValues)
+{
+    int numbers[5];
+    int dot;
+
+    GenerateNumbers(0, numbers, &dot);
+    CHECK(allDashes(numbers, dot));
+
+    // Digits are least significant first, dots counted from the left.
+    checkDigits(0.5, {0, 5, 0, blank, blank}, 2);
+    checkDigits(1.996, {0, 0, 2, blank, blank}, 2);
+    checkDigits(999.996, {0, 0, 0, 0, 1}, 3);
+    checkDigits(9999.96, {0, 0, 0, 0, 1}, blank);
+    checkDigits(1234.56, {6, 4, 3, 2, 1}, 3);
+    checkDigits(99999.4, {9, 9, 9, 9, 9}, blank);
+
+    GenerateNumbers(99999.6, numbers, &dot);
+    CHECK(allDashes(numbers, dot));
+}
+
+TEST(formatterRejectsInvalidInput)
+{
+    const float invalid[] = {-0.01f, -1, -99999, 100000, 1e9f, NAN, INFINITY, -INFINITY};
+    for (float value : invalid)
+    {
+        int numbers[5];
+        int dot;
+        GenerateNumbers(value, numbers, &dot);
+        CHECK(allDashes(numbers, dot));
+    }
+}
+
+// Every value in range is shown to within half its last digit, with the
+// most decimals that fit in five digits.
+TEST(formatterFuzzRoundTrip)
+{
+    randomSeed(30);
+
+    for (int i = 0; i < 200000; i++)
+    {
+        // Spread over all magnitudes from 0.001 to 100000.
+        float value = pow(10, random(-3000, 5000) / 1000.0) * (1 + random(1000) / 1000000.0);
+        int numbers[5];
+        int dot;
+        GenerateNumbers(value, numbers, &dot);
+
+        if (lround(value) >= 100000)
+        {
+            CHECK(allDashes(numbers, dot));
+            continue;
+        }
+
+        double shown = shownValue(numbers, dot);
+        int decimals = dot == blank ? 0 : 4 - dot;
+        bool valid = shown >= 0 && fabs(shown - value) <= 0.5 * pow(10, -decimals) + value * 1e-6;
+
+        // Fewer decimals only when one more would not fit.
+        valid &= decimals == 2 || lround(value * pow(10, decimals + 1)) >= 100000;
+
+        if (!valid)
+        {
+            hostTest::fail(__FILE__, __LINE__, "digits show the value");
+            printf("  value %.6f shown %.6f with %d decimals\n", value, shown, decimals);
+            return;
+        }
+    }
+}
+
+// Rounding up at each power of ten carries into a new leading digit.
+TEST(formatterCarriesAtPowersOfTen)
+{
+    checkDigits(0.996, {0, 0, 1, blank, blank}, 2);
+    checkDigits(9.996, {0, 0, 0, 1, blank}, 2);
+    checkDigits(99.996, {0, 0, 0, 0, 1}, 2);
+    checkDigits(99.994, {9, 9, 9, 9, blank}, 2);
+    checkDigits(999.994, {9, 9, 9, 9, 9}, 2);
+    checkDigits(0.004, {0, 0, 0, blank, blank}, 2);
+}
+
+TEST(dayOfWeekMatchesCivilCalendar)
+{
+    const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    for (int year = 1900; year < 2200; year++)
+    {
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        for (int month = 1; month <= 12; month++)
+        {
+            int days = monthDays[month - 1] + (month == 2 && leap);
+            for (int day = 1; day <= days; day++)
+            {
+                // 1970-01-01 was a Thursday, Sunday is 0.
+                int expected = ((DaysFromCivil(year, month, day) + 4) % 7 + 7) % 7;
+                if (dayofweek(day, month, year) != expected)
+                {
+                    hostTest::fail(__FILE__, __LINE__, "dayofweek matches DaysFromCivil");
+                    printf("  %04d-%02d-%02d: %d, expected %d\n", year, month, day, dayofweek(day, month, year), expected);
+                    return;
+                }
+            }
+        }
+    }
+
+    CHECK_EQ(dayofweek(7, 8, 2020), 5); // Friday.
+    CHECK_EQ(dayofweek(29, 2, 2000), 2); // Tuesday.
+}
+
+TEST(colorPacksLikeNeoPixel)
+{
+    for (int r = 0; r < 256; r++)
+    {
+        for (int g = 0; g < 256; g++)
+        {
+            for (int b = 0; b < 256; b += 51)
+            {
+                uint32_t color = Color(r, g, b);
+                if (color != Adafruit_NeoPixel::Color(r, g, b) || color >> 24 ||
+                    (int)(color >> 16) != r || (int)(color >> 8 & 0xFF) != g || (int)(color & 0xFF) != b)
+                {
+                    hostTest::fail(__FILE__, __LINE__, "Color(r, g, b) packs 0x00RRGGBB");
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST(swapRGSwapsOnlyRedAndGreen)
+{
+    randomSeed(31);
+
+    for (int i = 0; i < 100000; i++)
+    {
+        uint32_t color = random(0, 0x1000000);
+        uint32_t swapped = SwapRG(color);
+
+        if (swapped != Color(color >> 8 & 0xFF, color >> 16 & 0xFF, color & 0xFF) || SwapRG(swapped) != color)
+        {
+            hostTest::fail(__FILE__, __LINE__, "SwapRG swaps red and green and is its own inverse");
+            return;
+        }
+    }
+
+    // The top byte is not part of the colour.
+    CHECK_EQ(SwapRG(0xFF123456), 0x00341256u);
+}
+
+TEST(wheelIsAContinuousRainbow)
+{
+    CHECK_EQ(Wheel(0), Color(255, 0, 0));
+    CHECK_EQ(Wheel(85), Color(0, 255, 0));
+    CHECK_EQ(Wheel(170), Color(0, 0, 255));
+
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t color = Wheel(i);
+        uint32_t next = Wheel((i + 1) & 0xFF);
+        int r = color >> 16, g = color >> 8 & 0xFF, b = color & 0xFF;
+
+        // Two channels mix to full scale, the third is off.
+        CHECK_EQ(r + g + b, 255);
+        CHECK(r == 0 || g == 0 || b == 0);
+
+        // Neighbours, including 255 to 0, differ by one step.
+        CHECK(abs(r - (int)(next >> 16)) <= 3);
+        CHECK(abs(g - (int)(next >> 8 & 0xFF)) <= 3);
+        CHECK(abs(b - (int)(next & 0xFF)) <= 3);
+    }
+}
+
+// Samples a flasher every millisecond.
+struct FlasherTrace
+{
+    int minimum = 1 << 30;
+    int maximum = -1;
+    int onMillis = 0;
+    int cycles = 0;
+    int transitions = 0;
+    bool onlyOnOff = true;
+    int longestOn = 0;
+    int longestOff = 0;
+    int shortestOff = 1 << 30;
+};
+
+static FlasherTrace traceFlasher(flasher &f, int millis, int maxPwm)
+{
+    FlasherTrace trace;
+    int last = f.getPwmValue();
+    int run = 0;
+
+    for (int i = 0; i < millis; i++)
+    {
+        host::advanceMillis(1);
+        int value = f.getPwmValue();
+
+        trace.minimum = min(trace.minimum, value);
+        trace.maximum = max(trace.maximum, value);
+        trace.onMillis += value > 0;
+        trace.cycles += f.endOfCycle();
+        trace.onlyOnOff &= value == 0 || value == maxPwm;
+
+        if (value != last && (value == 0 || last == 0))
+        {
+            trace.transitions++;
+            if (last)
+            {
+                trace.longestOn = max(trace.longestOn, run);
+            }
+            else if (trace.transitions > 1)
+            {
+                trace.longestOff = max(trace.longestOff, run);
+                trace.shortestOff = min(trace.shortestOff, run);
+            }
+            run = 0;
+        }
+        run++;
+        last = value;
+    }
+    return trace;
+}
+
+TEST(flasherSolidStaysOn)
+{
+    flasher f(Pattern::Solid, 1000, 200);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 5000, 200);
+    CHECK_EQ(trace.minimum, 200);
+    CHECK_EQ(trace.maximum, 200);
+}
+
+TEST(flasherOnOffHasHalfDuty)
+{
+    flasher f(Pattern::OnOff, 1000, 255);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 10000, 255);
+    CHECK(trace.onlyOnOff);
+    CHECK_NEAR(trace.onMillis, 5000, 100);
+    CHECK_NEAR(trace.transitions, 20, 2);
+}
+
+TEST(flasherFlashHasTenthDuty)
+{
+    flasher f(Pattern::Flash, 1000, 255);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 10000, 255);
+    CHECK(trace.onlyOnOff);
+    CHECK_NEAR(trace.onMillis, 1000, 50);
+    CHECK_NEAR(trace.longestOn, 100, 2);
+}
+
+TEST(flasherSinStaysInRangeAndCycles)
+{
+    flasher f(Pattern::Sin, 1000, 255);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 10000, 255);
+    CHECK(trace.minimum >= 0);
+    CHECK(trace.maximum <= 255 && trace.maximum >= 250);
+    CHECK_NEAR(trace.cycles, 10, 1);
+}
+
+TEST(flasherRampUpRisesThenRestarts)
+{
+    flasher f(Pattern::RampUp, 1000, 100);
+    f.reset();
+
+    int last = 0;
+    int drops = 0;
+    int cycles = 0;
+    for (int i = 0; i < 10000; i++)
+    {
+        host::advanceMillis(1);
+        int value = f.getPwmValue();
+        CHECK(value >= 0 && value <= 100);
+        drops += value < last;
+        cycles += f.endOfCycle();
+        last = value;
+    }
+    CHECK_EQ(drops, cycles);
+    CHECK_NEAR(cycles, 10, 1);
+}
+
+TEST(flasherRandomFlashesKeepTheirTiming)
+{
+    randomSeed(32);
+
+    flasher f(Pattern::RandomFlash, 1000, 255);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 60000, 255);
+    CHECK(trace.onlyOnOff);
+    CHECK_NEAR(trace.longestOn, 100, 2);
+    CHECK(trace.shortestOff >= 500 - 2 && trace.longestOff <= 1500 + 2);
+    CHECK(trace.cycles > 30);
+
+    flasher reverse(Pattern::RandomReverseFlash, 1000, 255);
+    reverse.reset();
+    trace = traceFlasher(reverse, 60000, 255);
+    CHECK(trace.onlyOnOff);
+    CHECK(trace.longestOff <= 100 + 2);
+    CHECK(trace.onMillis > 50000);
+}
+
+// Without repeat the output stays off after a cycle until reset().
+TEST(flasherWithoutRepeatHoldsOffAfterACycle)
+{
+    flasher f(Pattern::RampUp, 500, 50);
+    f.reset();
+    f.repeat(false);
+
+    int peak = 0;
+    int offMillis = 0;
+    for (int i = 0; i < 3000; i++)
+    {
+        host::advanceMillis(1);
+        int value = f.getPwmValue();
+        peak = max(peak, value);
+        offMillis += i >= 600 && value == 0;
+    }
+    CHECK_EQ(peak, 50);
+    CHECK_EQ(offMillis, 2400);
+
+    CHECK(f.endOfCycle());
+    f.reset();
+    host::advanceMillis(100);
+    CHECK(f.getPwmValue() > 0);
+}
+
+// micros() wraps every ~71.6 minutes.
+TEST(flasherSurvivesMicrosRollover)
+{
+    host::nowMicros = 0xFFFFFFFFull - 2500000;
+
+    flasher f(Pattern::OnOff, 1000, 255);
+    f.reset();
+    FlasherTrace trace = traceFlasher(f, 10000, 255);
+    CHECK_NEAR(trace.onMillis, 5000, 100);
+    CHECK_NEAR(trace.transitions, 20, 2);
+}
+
+TEST(msTimerFiresAcrossMillisRollover)
+{
+    host::setMillis(0xFFFFFFFF - 500);
+    msTimer timer(1000);
+
+    host::advanceMillis(400);
+    CHECK(!timer.elapsed());
+
+    // millis() wrapped to a small value, 1001 ms after the start.
+    host::advanceMillis(601);
+    CHECK(millis() < 1000);
+    CHECK(timer.elapsed());
+    CHECK(!timer.elapsed());
+
+    host::advanceMillis(1001);
+    CHECK(timer.elapsed());
+}
+
+TEST(msTimerPeriodIsStableThroughRollover)
+{
+    host::setMillis(0xFFFFFFFF - 50000);
+    msTimer timer(999);
+
+    int fired = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        host::advanceMillis(1);
+        fired += timer.elapsed();
+    }
+    CHECK_EQ(fired, 100);
+}
+
+TEST(msTimerForceTriggerAndDelayChangesNearRollover)
+{
+    // ForceTrigger() just after the rollover puts the start before zero.
+    host::setMillis(100);
+    msTimer timer(1000);
+    timer.ForceTrigger();
+    CHECK(timer.elapsed());
+    CHECK(!timer.elapsed());
+
+    host::setMillis(0xFFFFFFFF - 10);
+    timer.setDelayAndReset(20);
+    host::advanceMillis(20);
+    CHECK(!timer.elapsed());
+    host::advanceMillis(1);
+    CHECK(timer.elapsed());
+
+    // An unchanged delay does not restart the timer.
+    host::advanceMillis(15);
+    timer.setDelay(20);
+    host::advanceMillis(6);
+    CHECK(timer.elapsed());
+}
+
+int main()
+{
+    return hostTest::run();
+}
@@ -0,0 +1,92 @@
+// Host test helpers
+//
+// Minimal test registration and checks for the host tests, one binary per
+// test file. A failed check reports and continues with the next check.
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+namespace hostTest
+{
+    struct Test
+    {
+        const char *name;
+        void (*run)();
+    };
+
+    inline std::vector<Test> &tests()
+    {
+        static std::vector<Test> all;
+        return all;
+    }
+
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char *name, void (*run)())
+        {
+            tests().push_back({name, run});
+        }
+    };
+
+    inline void fail(const char *file, int line, const char *expression)
+    {
+        printf("  FAIL %s:%d: %s\n", file, line, expression);
+        failures()++;
+    }
+
+    inline int run()
+    {
+        for (const Test &test : tests())
+        {
+            int before = failures();
+            test.run();
+            printf("%s %s\n", failures() == before ? "ok  " : "FAIL", test.name);
+        }
+        printf("%zu tests, %d failed checks\n", tests().size(), failures());
+        return failures() ? 1 : 0;
+    }
+}
+
+#define TEST(name)                                                     \
+    static void name();                                                \
+    static hostTest::Registrar name##Registrar(#name, name);           \
+    static void name()
+
+#define CHECK(condition)                                               \
+    do                                                                 \
+    {                                                                  \
+        if (!(condition))                                              \
+        {                                                              \
+            hostTest::fail(__FILE__, __LINE__, #condition);            \
+        }                                                              \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                     \
+    do                                                                 \
+    {                                                                  \
+        if (!((actual) == (expected)))                                 \
+        {                                                              \
+            hostTest::fail(__FILE__, __LINE__, #actual " == " #expected); \
+        }                                                              \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                        \
+    do                                                                 \
+    {                                                                  \
+        if (!(fabs((double)(actual) - (double)(expected)) <= (tolerance))) \
+        {                                                              \
+            hostTest::fail(__FILE__, __LINE__, #actual " ~ " #expected);  \
+        }                                                              \
+    } while (0)
+
+#endif
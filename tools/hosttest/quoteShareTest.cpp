@@ -0,0 +1,241 @@
+// Quote share tests: a leader and several followers on the simulated LAN,
+// plus the share settings read from the SD card.
+
+#include "hostTest.h"
+#include "quoteShare.h"
+#include <SD.h>
+
+// From firmware/src/main.cpp.
+bool GetParametersFromSDCard();
+extern String shareMode;
+extern int sharePort;
+void ScheduleInstruments();
+int NextDueInstrument(uint32_t lead);
+
+const IPAddress group(239, 255, 57, 57);
+const uint16_t port = 5757;
+
+static void connectWifi()
+{
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        return;
+    }
+
+    host::networks.push_back({"Lan", "secret", {2, 0, 0, 0, 0, 1}, 6, true, 3000, 800, 500,
+                              IPAddress(192, 168, 1, 50), IPAddress(192, 168, 1, 1)});
+    WiFi.begin("Lan", "secret");
+    host::advanceMillis(5000);
+}
+
+static void setQuote(ShareQuote &quote, const char *symbol, float open, float close, uint32_t ageMillis = 0)
+{
+    strncpy(quote.symbol, symbol, sizeof(quote.symbol));
+    quote.open = lround(open * sharePriceScale);
+    quote.close = lround(close * sharePriceScale);
+    quote.ageMillis = ageMillis;
+}
+
+static bool sendQuotes(quoteShare &leader, uint32_t epoch)
+{
+    setQuote(leader.quotes()[0], "XAU", 2040, 2050.25f);
+    setQuote(leader.quotes()[1], "XAG", 23, 22.9f, 45000);
+    setQuote(leader.quotes()[2], "XPT", 900, 901.5f);
+    return leader.send(epoch, 3);
+}
+
+TEST(snapshotReachesEveryFollower)
+{
+    connectWifi();
+    CHECK_EQ(WiFi.status(), WL_CONNECTED);
+
+    quoteShare leader, first, second;
+    leader.begin(ShareMode::Leader, group, port);
+    first.begin(ShareMode::Follower, group, port);
+    second.begin(ShareMode::Follower, group, port);
+    CHECK(first.join() && second.join());
+
+    CHECK(sendQuotes(leader, 1700000000));
+
+    for (quoteShare *follower : {&first, &second})
+    {
+        CHECK(follower->receive());
+        CHECK_EQ(follower->header().count, 3);
+        CHECK_EQ(follower->header().epoch, 1700000000u);
+        CHECK_EQ(follower->header().sequence, 1u);
+        CHECK(strcmp(follower->quotes()[0].symbol, "XAU") == 0);
+        CHECK_EQ(follower->quotes()[0].close, 20502500);
+        CHECK(strcmp(follower->quotes()[2].symbol, "XPT") == 0);
+        CHECK_EQ(follower->quotes()[2].open, 9000000);
+        CHECK_EQ(follower->quotes()[1].ageMillis, 45000u); // A heartbeat repeating an older price.
+        CHECK(follower->leaderAlive());
+
+        // One snapshot, one receive.
+        CHECK(!follower->receive());
+    }
+
+    // The leader does not hear itself.
+    CHECK(!leader.receive());
+}
+
+TEST(otherGroupsAndPortsAreNotHeard)
+{
+    connectWifi();
+
+    quoteShare leader, otherPort, otherGroup;
+    leader.begin(ShareMode::Leader, group, port);
+    otherPort.begin(ShareMode::Follower, group, port + 1);
+    otherGroup.begin(ShareMode::Follower, IPAddress(239, 255, 57, 58), port);
+    CHECK(otherPort.join() && otherGroup.join());
+
+    CHECK(sendQuotes(leader, 0));
+    CHECK(!otherPort.receive());
+    CHECK(!otherGroup.receive());
+}
+
+TEST(leaderGoesQuietAndComesBack)
+{
+    connectWifi();
+
+    quoteShare leader, follower;
+    leader.begin(ShareMode::Leader, group, port);
+    follower.begin(ShareMode::Follower, group, port);
+    CHECK(follower.join());
+
+    CHECK(!follower.leaderAlive());
+    CHECK(sendQuotes(leader, 0));
+    CHECK(follower.receive());
+    CHECK(!leader.heartbeatDue());
+
+    host::advanceMillis(10000);
+    CHECK(leader.heartbeatDue());
+    CHECK(follower.leaderAlive());
+
+    host::advanceMillis(25000);
+    CHECK(!follower.leaderAlive());
+
+    CHECK(sendQuotes(leader, 0));
+    CHECK(follower.receive());
+    CHECK(follower.leaderAlive());
+    CHECK_EQ(follower.header().sequence, 2u);
+}
+
+TEST(lostSnapshotsLeaveGapsInTheSequence)
+{
+    connectWifi();
+
+    quoteShare leader, follower;
+    leader.begin(ShareMode::Leader, group, port);
+    follower.begin(ShareMode::Follower, group, port);
+    CHECK(follower.join());
+
+    host::udpDropEvery = 2;
+    uint32_t dropped = host::udpDropped;
+    int received = 0;
+    uint32_t lastSequence = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        sendQuotes(leader, 0);
+        while (follower.receive())
+        {
+            CHECK(follower.header().sequence > lastSequence);
+            lastSequence = follower.header().sequence;
+            received++;
+        }
+    }
+    host::udpDropEvery = 0;
+
+    CHECK_EQ(received, 5);
+    CHECK_EQ(host::udpDropped - dropped, 5u);
+    CHECK(lastSequence >= 9); // The last one may be lost.
+}
+
+TEST(malformedPacketsAreRejected)
+{
+    connectWifi();
+
+    quoteShare follower;
+    follower.begin(ShareMode::Follower, group, port);
+    CHECK(follower.join());
+
+    WiFiUDP sender;
+    CHECK(sender.begin(port));
+
+    struct __attribute__((packed))
+    {
+        ShareHeader header;
+        ShareQuote quotes[2];
+    } packet = {{shareMagic, shareVersion, 2, 1, 0}, {}};
+    memcpy(packet.quotes[0].symbol, "UNTERMINATED", sizeof(packet.quotes[0].symbol));
+
+    auto deliver = [&](size_t length) {
+        sender.beginPacketMulticast(group, port, WiFi.localIP());
+        sender.write((const uint8_t *)&packet, length);
+        sender.endPacket();
+        return follower.receive();
+    };
+
+    // Truncated, then count and length disagreeing.
+    CHECK(!deliver(sizeof(ShareHeader) - 1));
+    CHECK(!deliver(sizeof(ShareHeader) + sizeof(ShareQuote)));
+
+    packet.header.version = shareVersion + 1;
+    CHECK(!deliver(sizeof(packet)));
+
+    packet.header.version = shareVersion;
+    packet.header.magic = 0;
+    CHECK(!deliver(sizeof(packet)));
+
+    // Valid, symbols are terminated.
+    packet.header.magic = shareMagic;
+    CHECK(deliver(sizeof(packet)));
+    CHECK_EQ(strlen(follower.quotes()[0].symbol), sizeof(ShareQuote::symbol) - 1);
+}
+
+TEST(sharingIsOffUntilConfigured)
+{
+    connectWifi();
+
+    quoteShare off;
+    CHECK(!off.join());
+    CHECK(!off.send(0, 0));
+    CHECK(!off.receive());
+
+    off.begin(ShareMode::Off, group, port);
+    CHECK(!off.join());
+    CHECK(!off.heartbeatDue());
+}
+
+TEST(sharePortIsReadFromTheCard)
+{
+    // Card values are strings.
+    host::files["/wifi.txt"] = std::make_shared<std::string>(
+        "{\"ssid\": \"Lan\", \"share mode\": \"follower\", \"share port\": \"6060\"}");
+    CHECK(GetParametersFromSDCard());
+    CHECK(shareMode == "follower");
+    CHECK_EQ(sharePort, 6060);
+
+    host::files["/wifi.txt"] = std::make_shared<std::string>("{\"ssid\": \"Lan\"}");
+    CHECK(GetParametersFromSDCard());
+    CHECK_EQ(sharePort, 5757);
+}
+
+TEST(followerWithoutApiBudgetDoesNotPoll)
+{
+    // Prices only from the leader.
+    host::files["/wifi.txt"] = std::make_shared<std::string>(
+        "{\"ssid\": \"Lan\", \"share mode\": \"follower\", \"api calls per hour\": \"0\"}");
+    CHECK(GetParametersFromSDCard());
+    ScheduleInstruments();
+    CHECK_EQ(NextDueInstrument(0), -1);
+
+    host::files["/wifi.txt"] = std::make_shared<std::string>("{\"ssid\": \"Lan\", \"share mode\": \"follower\"}");
+    CHECK(GetParametersFromSDCard());
+    ScheduleInstruments();
+    CHECK_EQ(NextDueInstrument(0), 0);
+}
+
+int main()
+{
+    return hostTest::run();
+}
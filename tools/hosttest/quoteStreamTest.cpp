@@ -0,0 +1,115 @@
+// Quote stream tests: tick parsing from a simulated relay, and the relay
+// clock offset learned from the tick send times.
+
+#include "hostTest.h"
+#include "quoteStream.h"
+#include <memory>
+
+static std::shared_ptr<host::TcpEndpoint> relay;
+
+static void connectWifi()
+{
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        return;
+    }
+
+    host::networks.push_back({"Lan", "secret", {2, 0, 0, 0, 0, 1}, 6, true, 3000, 800, 500,
+                              IPAddress(192, 168, 1, 50), IPAddress(192, 168, 1, 1)});
+    WiFi.begin("Lan", "secret");
+    host::advanceMillis(5000);
+}
+
+// A stream connected to a fresh relay, past the response header.
+static quoteStream &connectedStream()
+{
+    static quoteStream *stream = nullptr;
+    delete stream;
+
+    connectWifi();
+    relay = host::addEndpoint("relay", 8080);
+    stream = new quoteStream();
+    stream->begin("relay", 8080, "/ticks");
+
+    CHECK(!stream->poll());
+    relay->toClient += "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n";
+    CHECK(!stream->poll());
+    CHECK(stream->live());
+    return *stream;
+}
+
+TEST(ticksAreParsedWithAndWithoutOptionalFields)
+{
+    quoteStream &stream = connectedStream();
+    relay->toClient += "data: XAU 1923.45 1910.10\n\ndata: XAG 23.5\n\nevent: ping\n\n";
+
+    CHECK(stream.poll());
+    CHECK(strcmp(stream.symbol(), "XAU") == 0);
+    CHECK(stream.close() == 1923.45f);
+    CHECK(stream.open() == 1910.10f);
+    CHECK(!stream.hasSentTime());
+
+    CHECK(stream.poll());
+    CHECK(strcmp(stream.symbol(), "XAG") == 0);
+    CHECK(stream.open() == 0);
+    CHECK(!stream.hasSentTime());
+
+    CHECK(!stream.poll());
+}
+
+TEST(sendTimeIncludesTimeWaitingInTheSocket)
+{
+    quoteStream &stream = connectedStream();
+
+    // Read as soon as it is sent: the relay clock is 900000 ms ahead of millis().
+    uint32_t start = millis();
+    relay->toClient += "data: XAU 1923.45 1910.10 " + std::to_string(start + 900000) + "\n\n";
+    CHECK(stream.poll());
+    CHECK(stream.hasSentTime());
+    CHECK_EQ(stream.sentMillis(), start);
+
+    // Sent 100 ms later, read 600 ms later while the loop was blocked.
+    host::advanceMillis(600);
+    relay->toClient += "data: XAU 1924.00 1910.10 " + std::to_string(start + 900100) + "\n\n";
+    CHECK(stream.poll());
+    CHECK_EQ(stream.sentMillis(), start + 100);
+    CHECK_EQ(millis() - stream.sentMillis(), 500u);
+}
+
+TEST(fasterTickLowersTheLearnedOffset)
+{
+    quoteStream &stream = connectedStream();
+
+    // The first tick already waited 300 ms.
+    uint32_t start = millis();
+    relay->toClient += "data: XAU 1923.45 1910.10 1000\n\n";
+    CHECK(stream.poll());
+    CHECK_EQ(millis() - stream.sentMillis(), 0u);
+
+    // One read promptly sets the real offset, the first tick is now 300 ms late.
+    host::advanceMillis(1000);
+    relay->toClient += "data: XAU 1924.00 1910.10 2300\n\n";
+    CHECK(stream.poll());
+    CHECK_EQ(millis() - stream.sentMillis(), 0u);
+    CHECK_EQ(stream.sentMillis() - 1300, start - 300);
+}
+
+TEST(offsetIsRelearnedAfterAReconnect)
+{
+    quoteStream &stream = connectedStream();
+    relay->toClient += "data: XAU 1923.45 1910.10 1000\n\n";
+    CHECK(stream.poll());
+
+    // Another relay, its clock far behind.
+    stream.stop();
+    host::advanceMillis(10000);
+    CHECK(!stream.poll());
+    relay->toClient += "HTTP/1.1 200 OK\r\n\r\ndata: XAU 1924.00 1910.10 50\n\n";
+    CHECK(stream.poll());
+    CHECK_EQ(stream.sentMillis(), millis());
+}
+
+int main()
+{
+    return hostTest::run();
+}
@@ -0,0 +1,103 @@
+// Adafruit NeoPixel shim for host tests
+//
+// Keeps the pixel buffer in the library's GRB order. show() takes the
+// WS2812 transfer time on the virtual clock, counts frames and hands the
+// strip to host::showHook so tests can capture what was displayed.
+
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel;
+
+namespace host
+{
+    extern std::function<void(Adafruit_NeoPixel &strip)> showHook;
+    extern uint32_t frames; // show() calls on all strips.
+}
+
+class Adafruit_NeoPixel
+{
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+        : _pixels(n * 3), _pin(pin) {}
+
+    void begin() {}
+
+    void show()
+    {
+        // 30 us per pixel and the 300 us latch.
+        host::advance(_pixels.size() / 3 * 30 + 300);
+        host::frames++;
+        if (host::showHook)
+        {
+            host::showHook(*this);
+        }
+    }
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (n < numPixels())
+        {
+            if (_brightness)
+            {
+                r = (r * _brightness) >> 8;
+                g = (g * _brightness) >> 8;
+                b = (b * _brightness) >> 8;
+            }
+            _pixels[n * 3] = g;
+            _pixels[n * 3 + 1] = r;
+            _pixels[n * 3 + 2] = b;
+        }
+    }
+    void setPixelColor(uint16_t n, uint32_t c) { setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c); }
+
+    uint32_t getPixelColor(uint16_t n) const
+    {
+        if (n >= numPixels())
+        {
+            return 0;
+        }
+        uint32_t r = _pixels[n * 3 + 1], g = _pixels[n * 3], b = _pixels[n * 3 + 2];
+        if (_brightness)
+        {
+            r = (r << 8) / _brightness;
+            g = (g << 8) / _brightness;
+            b = (b << 8) / _brightness;
+        }
+        return (r << 16) | (g << 8) | b;
+    }
+
+    void setBrightness(uint8_t brightness) { _brightness = brightness + 1; }
+    void clear() { std::fill(_pixels.begin(), _pixels.end(), 0); }
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0)
+    {
+        uint16_t end = count ? min<uint16_t>(first + count, numPixels()) : numPixels();
+        for (uint16_t i = first; i < end; i++)
+        {
+            setPixelColor(i, c);
+        }
+    }
+
+    uint8_t *getPixels() { return _pixels.data(); }
+    uint16_t numPixels() const { return _pixels.size() / 3; }
+    int16_t getPin() const { return _pin; }
+    bool canShow() { return true; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+private:
+    std::vector<uint8_t> _pixels;
+    int16_t _pin;
+    uint16_t _brightness = 0; // 0: full, else brightness + 1 like the library.
+};
+
+#endif
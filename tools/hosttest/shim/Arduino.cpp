@@ -0,0 +1,125 @@
+// Arduino shim for host tests, virtual clock and pins.
+
+#include <Arduino.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace host
+{
+    uint64_t nowMicros = 0;
+    void (*idleHook)() = nullptr;
+
+    static int pinLevels[32];
+    static void (*pinHandlers[32])();
+
+    void advance(uint64_t micros)
+    {
+        nowMicros += micros;
+    }
+
+    void advanceMillis(uint64_t millis)
+    {
+        nowMicros += millis * 1000;
+    }
+
+    void setMillis(uint32_t millis)
+    {
+        nowMicros = (uint64_t)millis * 1000;
+    }
+
+    void setPin(uint8_t pin, int level)
+    {
+        if (pinLevels[pin] == level)
+        {
+            return;
+        }
+
+        pinLevels[pin] = level;
+        if (pinHandlers[pin])
+        {
+            pinHandlers[pin]();
+        }
+    }
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(host::nowMicros / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)host::nowMicros;
+}
+
+void delay(unsigned long ms)
+{
+    host::advanceMillis(ms);
+    if (host::idleHook)
+    {
+        host::idleHook();
+    }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    host::advance(us);
+}
+
+void yield()
+{
+    if (host::idleHook)
+    {
+        host::idleHook();
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP)
+    {
+        host::pinLevels[pin] = HIGH;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return host::pinLevels[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+    host::pinLevels[pin] = level;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode)
+{
+    host::pinHandlers[interrupt] = handler;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+    host::pinHandlers[interrupt] = nullptr;
+}
+
+static uint32_t randomState = 1;
+
+void randomSeed(unsigned long seed)
+{
+    randomState = seed ? seed : 1;
+}
+
+long random(long max)
+{
+    // xorshift32, deterministic across hosts.
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return max > 0 ? randomState % max : 0;
+}
+
+long random(long min, long max)
+{
+    return max > min ? min + random(max - min) : min;
+}
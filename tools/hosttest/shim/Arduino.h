@@ -0,0 +1,336 @@
+// Arduino shim for host tests
+//
+// The subset of the ESP8266 Arduino core used by the firmware, backed by
+// a virtual clock (host::advance) and scriptable pins. Time only moves
+// when a test advances it or the firmware calls delay().
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define digitalPinToInterrupt(pin) (pin)
+
+// NodeMCU pin names.
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+
+#define radians(degrees) ((degrees) * 0.017453292519943295)
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+// Virtual time and pins, driven by the tests.
+namespace host
+{
+    extern uint64_t nowMicros;
+
+    void advance(uint64_t micros);
+    void advanceMillis(uint64_t millis);
+    void setMillis(uint32_t millis); // E.g. just before the 49.7 day rollover.
+
+    // Called on every delay()/yield(), lets a simulation run background work.
+    extern void (*idleHook)();
+
+    void setPin(uint8_t pin, int level); // Runs an attached CHANGE interrupt.
+}
+
+// 32 bit like the ESP8266, so both wrap around as on the device.
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+class String
+{
+public:
+    std::string s;
+
+    String() {}
+    String(const char *text) : s(text ? text : "") {}
+    String(const std::string &text) : s(text) {}
+    String(char c) : s(1, c) {}
+    String(int value) : s(std::to_string(value)) {}
+    String(unsigned value) : s(std::to_string(value)) {}
+    String(long value) : s(std::to_string(value)) {}
+    String(unsigned long value) : s(std::to_string(value)) {}
+    String(float value, unsigned char decimals = 2) { format(value, decimals); }
+    String(double value, unsigned char decimals = 2) { format(value, decimals); }
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    bool reserve(unsigned size) { s.reserve(size); return true; }
+    char operator[](unsigned i) const { return i < s.size() ? s[i] : 0; }
+    char charAt(unsigned i) const { return (*this)[i]; }
+
+    String substring(unsigned from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const { return from < s.size() && to > from ? String(s.substr(from, to - from)) : String(); }
+    int indexOf(char c, unsigned from = 0) const { size_t i = s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+    int indexOf(const String &text, unsigned from = 0) const { size_t i = s.find(text.s, from); return i == std::string::npos ? -1 : (int)i; }
+    bool startsWith(const String &prefix) const { return s.rfind(prefix.s, 0) == 0; }
+    bool endsWith(const String &suffix) const { return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0; }
+    bool equals(const String &other) const { return s == other.s; }
+    bool equalsIgnoreCase(const String &other) const { return strcasecmp(s.c_str(), other.s.c_str()) == 0; }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+    void toUpperCase() { for (char &c : s) c = toupper(c); }
+    void toLowerCase() { for (char &c : s) c = tolower(c); }
+    void trim()
+    {
+        size_t first = s.find_first_not_of(" \t\r\n");
+        size_t last = s.find_last_not_of(" \t\r\n");
+        s = first == std::string::npos ? "" : s.substr(first, last - first + 1);
+    }
+
+    String operator+(const String &other) const { return String(s + other.s); }
+    String operator+(const char *other) const { return String(s + other); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s); }
+    String &operator+=(const String &other) { s += other.s; return *this; }
+    String &operator+=(const char *other) { s += other; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    bool operator==(const String &other) const { return s == other.s; }
+    bool operator==(const char *other) const { return s == other; }
+    bool operator!=(const String &other) const { return s != other.s; }
+    bool operator!=(const char *other) const { return s != other; }
+    bool operator<(const String &other) const { return s < other.s; }
+
+private:
+    void format(double value, unsigned char decimals)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        s = text;
+    }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size-- && write(*buffer++))
+        {
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(const char *text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(unsigned value) { return print(String(value)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+    template <class T>
+    size_t println(const T &value) { return print(value) + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char text[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        return length > 0 ? write((const uint8_t *)text, min(length, (int)sizeof(text) - 1)) : 0;
+    }
+
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() { return _timeout; }
+
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0)
+        {
+            buffer[n++] = c;
+        }
+        return n;
+    }
+    size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+    String readString()
+    {
+        String text;
+        int c;
+        while ((c = read()) >= 0)
+        {
+            text += (char)c;
+        }
+        return text;
+    }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+// Serial output is collected for the tests to inspect.
+class HardwareSerial : public Stream
+{
+public:
+    std::string output;
+    bool echo = false; // Also print to stdout.
+
+    void begin(unsigned long baud) {}
+    size_t write(uint8_t c) override
+    {
+        output += (char)c;
+        if (echo)
+        {
+            putchar(c);
+        }
+        return 1;
+    }
+    using Print::write;
+    int availableForWrite() { return 128; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+};
+
+extern HardwareSerial Serial;
+
+// Stored like the ESP8266 core: first octet in the lowest byte.
+class IPAddress
+{
+public:
+    uint8_t bytes[4] = {};
+
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t address) { memcpy(bytes, &address, 4); }
+
+    operator uint32_t() const
+    {
+        uint32_t address;
+        memcpy(&address, bytes, 4);
+        return address;
+    }
+    uint8_t operator[](int i) const { return bytes[i]; }
+    bool isSet() const { return (uint32_t) * this != 0; }
+
+    bool fromString(const char *text)
+    {
+        unsigned a, b, c, d;
+        char end;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+        {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    bool fromString(const String &text) { return fromString(text.c_str()); }
+
+    String toString() const
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(text);
+    }
+};
+
+// RTC user memory survives "reboots" within one test process.
+class EspClass
+{
+public:
+    uint32_t freeHeap = 40000;
+    uint8_t rtcMemory[512] = {};
+
+    uint32_t getFreeHeap() { return freeHeap; }
+    uint16_t getMaxFreeBlockSize() { return freeHeap / 2; }
+    uint8_t getHeapFragmentation() { return 10; }
+    uint32_t getCycleCount() { return (uint32_t)(host::nowMicros * 80); }
+    void restart() {}
+
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+    {
+        if (offset * 4 + size > sizeof(rtcMemory))
+        {
+            return false;
+        }
+        memcpy(data, rtcMemory + offset * 4, size);
+        return true;
+    }
+
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+    {
+        if (offset * 4 + size > sizeof(rtcMemory))
+        {
+            return false;
+        }
+        memcpy(rtcMemory + offset * 4, data, size);
+        return true;
+    }
+};
+
+extern EspClass ESP;
+
+#endif
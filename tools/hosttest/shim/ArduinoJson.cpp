@@ -0,0 +1,338 @@
+// ArduinoJson shim for host tests, parser and filter.
+
+#include <ArduinoJson.h>
+
+namespace hostJson
+{
+    class Parser
+    {
+    public:
+        Parser(const char *input, size_t length) : _p(input), _end(input + length) {}
+
+        DeserializationError parse(Node &node, int depth = 0)
+        {
+            skipSpace();
+            if (_p == _end)
+            {
+                return DeserializationError::IncompleteInput;
+            }
+            if (depth > 20)
+            {
+                return DeserializationError::TooDeep;
+            }
+
+            switch (*_p)
+            {
+            case '{':
+                return parseObject(node, depth);
+            case '[':
+                return parseArray(node, depth);
+            case '"':
+                node.type = Node::Text;
+                return parseString(node.text);
+            case 't':
+                node.type = Node::Bool;
+                node.boolean = true;
+                return literal("true");
+            case 'f':
+                node.type = Node::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+                return parseNumber(node);
+            }
+        }
+
+        bool atEnd()
+        {
+            skipSpace();
+            return _p == _end;
+        }
+
+    private:
+        const char *_p;
+        const char *_end;
+
+        void skipSpace()
+        {
+            while (_p < _end && isspace((unsigned char)*_p))
+            {
+                _p++;
+            }
+        }
+
+        DeserializationError literal(const char *word)
+        {
+            size_t length = strlen(word);
+            if ((size_t)(_end - _p) < length)
+            {
+                return strncmp(_p, word, _end - _p) == 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+            }
+            if (strncmp(_p, word, length) != 0)
+            {
+                return DeserializationError::InvalidInput;
+            }
+            _p += length;
+            return DeserializationError::Ok;
+        }
+
+        DeserializationError parseNumber(Node &node)
+        {
+            std::string text;
+            while (_p < _end && (isdigit((unsigned char)*_p) || strchr("+-.eE", *_p)))
+            {
+                text += *_p++;
+            }
+
+            char *end;
+            node.number = strtod(text.c_str(), &end);
+            if (text.empty() || *end)
+            {
+                return DeserializationError::InvalidInput;
+            }
+            node.type = Node::Number;
+            node.integer = text.find_first_of(".eE") == std::string::npos;
+            return DeserializationError::Ok;
+        }
+
+        DeserializationError parseString(std::string &text)
+        {
+            _p++;
+            while (_p < _end && *_p != '"')
+            {
+                if (*_p == '\\')
+                {
+                    if (++_p == _end)
+                    {
+                        break;
+                    }
+                    const char *escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+                    const char *e = strchr(escapes, *_p);
+                    if (!e || (e - escapes) % 2)
+                    {
+                        return DeserializationError::InvalidInput;
+                    }
+                    text += e[1];
+                    _p++;
+                }
+                else
+                {
+                    text += *_p++;
+                }
+            }
+            if (_p == _end)
+            {
+                return DeserializationError::IncompleteInput;
+            }
+            _p++;
+            return DeserializationError::Ok;
+        }
+
+        DeserializationError parseArray(Node &node, int depth)
+        {
+            node.type = Node::Array;
+            _p++;
+            skipSpace();
+            if (_p < _end && *_p == ']')
+            {
+                _p++;
+                return DeserializationError::Ok;
+            }
+
+            while (true)
+            {
+                std::shared_ptr<Node> item = std::make_shared<Node>();
+                DeserializationError error = parse(*item, depth + 1);
+                if (error)
+                {
+                    return error;
+                }
+                node.items.push_back(item);
+
+                skipSpace();
+                if (_p == _end)
+                {
+                    return DeserializationError::IncompleteInput;
+                }
+                if (*_p == ']')
+                {
+                    _p++;
+                    return DeserializationError::Ok;
+                }
+                if (*_p++ != ',')
+                {
+                    return DeserializationError::InvalidInput;
+                }
+            }
+        }
+
+        DeserializationError parseObject(Node &node, int depth)
+        {
+            node.type = Node::Object;
+            _p++;
+            skipSpace();
+            if (_p < _end && *_p == '}')
+            {
+                _p++;
+                return DeserializationError::Ok;
+            }
+
+            while (true)
+            {
+                skipSpace();
+                if (_p == _end)
+                {
+                    return DeserializationError::IncompleteInput;
+                }
+                if (*_p != '"')
+                {
+                    return DeserializationError::InvalidInput;
+                }
+
+                std::string key;
+                DeserializationError error = parseString(key);
+                if (error)
+                {
+                    return error;
+                }
+
+                skipSpace();
+                if (_p == _end)
+                {
+                    return DeserializationError::IncompleteInput;
+                }
+                if (*_p++ != ':')
+                {
+                    return DeserializationError::InvalidInput;
+                }
+
+                std::shared_ptr<Node> value = std::make_shared<Node>();
+                error = parse(*value, depth + 1);
+                if (error)
+                {
+                    return error;
+                }
+                node.members.push_back({key, value});
+
+                skipSpace();
+                if (_p == _end)
+                {
+                    return DeserializationError::IncompleteInput;
+                }
+                if (*_p == '}')
+                {
+                    _p++;
+                    return DeserializationError::Ok;
+                }
+                if (*_p++ != ',')
+                {
+                    return DeserializationError::InvalidInput;
+                }
+            }
+        }
+    };
+
+    // Keep what the filter allows: true keeps a value, an object keeps its
+    // listed members and an array applies its first element to all items.
+    static void applyFilter(Node &node, const Node &filter)
+    {
+        if (filter.type == Node::Bool && filter.boolean)
+        {
+            return;
+        }
+
+        if (filter.type == Node::Object && node.type == Node::Object)
+        {
+            std::vector<std::pair<std::string, std::shared_ptr<Node>>> kept;
+            for (auto &member : node.members)
+            {
+                std::shared_ptr<Node> memberFilter = filter.member(member.first);
+                if (!memberFilter)
+                {
+                    memberFilter = filter.member("*");
+                }
+                if (memberFilter)
+                {
+                    applyFilter(*member.second, *memberFilter);
+                    kept.push_back(member);
+                }
+            }
+            node.members = kept;
+            return;
+        }
+
+        if (filter.type == Node::Array && node.type == Node::Array && !filter.items.empty())
+        {
+            for (auto &item : node.items)
+            {
+                applyFilter(*item, *filter.items[0]);
+            }
+            return;
+        }
+
+        node = Node();
+    }
+
+    std::string serialize(const Node &node)
+    {
+        char text[32];
+        std::string out;
+
+        switch (node.type)
+        {
+        case Node::Null:
+            return "null";
+        case Node::Bool:
+            return node.boolean ? "true" : "false";
+        case Node::Number:
+            snprintf(text, sizeof(text), "%.9g", node.number);
+            return text;
+        case Node::Text:
+            return "\"" + node.text + "\"";
+        case Node::Array:
+            out = "[";
+            for (size_t i = 0; i < node.items.size(); i++)
+            {
+                out += (i ? "," : "") + serialize(*node.items[i]);
+            }
+            return out + "]";
+        case Node::Object:
+            out = "{";
+            for (size_t i = 0; i < node.members.size(); i++)
+            {
+                out += (i ? ",\"" : "\"") + node.members[i].first + "\":" + serialize(*node.members[i].second);
+            }
+            return out + "}";
+        }
+        return out;
+    }
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length)
+{
+    doc.clear();
+
+    hostJson::Parser parser(input, length);
+    if (parser.atEnd())
+    {
+        return DeserializationError::EmptyInput;
+    }
+
+    DeserializationError error = parser.parse(*doc.node());
+    if (error)
+    {
+        doc.clear();
+    }
+    return error;
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length, DeserializationOption::Filter filter)
+{
+    DeserializationError error = deserializeJson(doc, input, length);
+    if (!error)
+    {
+        hostJson::applyFilter(*doc.node(), *filter.node);
+    }
+    return error;
+}
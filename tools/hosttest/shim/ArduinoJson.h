@@ -0,0 +1,348 @@
+// ArduinoJson shim for host tests
+//
+// A small DOM with the ArduinoJson 6 behaviour the firmware relies on:
+// as<T>() parses numbers stored as strings, "variant | default" only
+// returns the value when it already has the default's type, as<String>()
+// of null is "null", and missing members are created on assignment.
+// Capacities are ignored.
+
+#ifndef HOST_ARDUINO_JSON_H
+#define HOST_ARDUINO_JSON_H
+
+#include <Arduino.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hostJson
+{
+    struct Node
+    {
+        enum Type
+        {
+            Null,
+            Bool,
+            Number,
+            Text,
+            Array,
+            Object
+        } type = Null;
+        bool boolean = false;
+        double number = 0;
+        bool integer = false;
+        std::string text;
+        std::vector<std::shared_ptr<Node>> items;
+        std::vector<std::pair<std::string, std::shared_ptr<Node>>> members;
+
+        std::shared_ptr<Node> member(const std::string &key) const
+        {
+            for (const auto &m : members)
+            {
+                if (m.first == key)
+                {
+                    return m.second;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    std::string serialize(const Node &node);
+}
+
+class JsonVariant
+{
+public:
+    JsonVariant() {}
+    explicit JsonVariant(std::shared_ptr<hostJson::Node> node) : _node(node) {}
+
+    JsonVariant operator[](const char *key) const { return member(key); }
+    JsonVariant operator[](const String &key) const { return member(key.s); }
+    JsonVariant operator[](int index) const
+    {
+        if (_node && _node->type == hostJson::Node::Array && index >= 0 && index < (int)_node->items.size())
+        {
+            return JsonVariant(_node->items[index]);
+        }
+        return JsonVariant();
+    }
+
+    bool isNull() const { return !_node || _node->type == hostJson::Node::Null; }
+    size_t size() const
+    {
+        return !_node ? 0 : _node->type == hostJson::Node::Array ? _node->items.size() : _node->members.size();
+    }
+
+    template <class T>
+    bool is() const
+    {
+        if (!_node)
+        {
+            return false;
+        }
+        if (std::is_same<T, bool>::value)
+        {
+            return _node->type == hostJson::Node::Bool;
+        }
+        if (std::is_integral<T>::value)
+        {
+            return _node->type == hostJson::Node::Number && _node->integer;
+        }
+        if (std::is_floating_point<T>::value)
+        {
+            return _node->type == hostJson::Node::Number;
+        }
+        return false;
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type as() const
+    {
+        if (!_node)
+        {
+            return 0;
+        }
+        switch (_node->type)
+        {
+        case hostJson::Node::Bool:
+            return _node->boolean;
+        case hostJson::Node::Number:
+            return (T)_node->number;
+        case hostJson::Node::Text:
+            return (T)strtod(_node->text.c_str(), nullptr);
+        default:
+            return 0;
+        }
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_same<T, String>::value, T>::type as() const
+    {
+        if (_node && _node->type == hostJson::Node::Text)
+        {
+            return String(_node->text);
+        }
+        return String(_node ? hostJson::serialize(*_node) : std::string("null"));
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_same<T, const char *>::value, T>::type as() const
+    {
+        return _node && _node->type == hostJson::Node::Text ? _node->text.c_str() : nullptr;
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_same<T, JsonVariant>::value, T>::type as() const
+    {
+        return *this;
+    }
+
+    template <class T, class = typename std::enable_if<std::is_arithmetic<T>::value || std::is_same<T, String>::value>::type>
+    operator T() const { return as<T>(); }
+
+    template <class T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type operator|(T fallback) const
+    {
+        return is<T>() ? as<T>() : fallback;
+    }
+    const char *operator|(const char *fallback) const
+    {
+        const char *text = as<const char *>();
+        return text ? text : fallback;
+    }
+
+    JsonVariant &operator=(const JsonVariant &other) = default;
+
+    template <class T>
+    JsonVariant &operator=(const T &value)
+    {
+        materialize();
+        assign(*_node, value);
+        return *this;
+    }
+
+    class iterator
+    {
+    public:
+        iterator(const hostJson::Node *node, size_t i) : _node(node), _i(i) {}
+        JsonVariant operator*() const
+        {
+            return JsonVariant(_node->type == hostJson::Node::Array ? _node->items[_i] : _node->members[_i].second);
+        }
+        iterator &operator++()
+        {
+            _i++;
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return _i != other._i; }
+
+    private:
+        const hostJson::Node *_node;
+        size_t _i;
+    };
+
+    iterator begin() const { return iterator(_node.get(), 0); }
+    iterator end() const { return iterator(_node.get(), size()); }
+
+    std::shared_ptr<hostJson::Node> node() const { return _node; }
+
+protected:
+    std::shared_ptr<hostJson::Node> _node;
+
+    // A missing member remembers where to create itself on assignment.
+    std::shared_ptr<JsonVariant> _parent;
+    std::string _key;
+
+    JsonVariant member(const std::string &key) const
+    {
+        std::shared_ptr<hostJson::Node> child = _node && _node->type == hostJson::Node::Object ? _node->member(key) : nullptr;
+        if (child)
+        {
+            return JsonVariant(child);
+        }
+
+        JsonVariant pending;
+        pending._parent = std::make_shared<JsonVariant>(*this);
+        pending._key = key;
+        return pending;
+    }
+
+    void materialize()
+    {
+        if (_node)
+        {
+            return;
+        }
+        if (!_parent)
+        {
+            _node = std::make_shared<hostJson::Node>();
+            return;
+        }
+
+        _parent->materialize();
+        if (_parent->_node->type != hostJson::Node::Object)
+        {
+            *_parent->_node = hostJson::Node();
+            _parent->_node->type = hostJson::Node::Object;
+        }
+        _node = _parent->_node->member(_key);
+        if (!_node)
+        {
+            _node = std::make_shared<hostJson::Node>();
+            _parent->_node->members.push_back({_key, _node});
+        }
+    }
+
+    static void assign(hostJson::Node &node, bool value)
+    {
+        node = hostJson::Node();
+        node.type = hostJson::Node::Bool;
+        node.boolean = value;
+    }
+    template <class T>
+    static typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type assign(hostJson::Node &node, T value)
+    {
+        node = hostJson::Node();
+        node.type = hostJson::Node::Number;
+        node.number = value;
+        node.integer = std::is_integral<T>::value;
+    }
+    static void assign(hostJson::Node &node, const char *value)
+    {
+        node = hostJson::Node();
+        node.type = hostJson::Node::Text;
+        node.text = value;
+    }
+    static void assign(hostJson::Node &node, const String &value) { assign(node, value.c_str()); }
+    template <size_t N>
+    static void assign(hostJson::Node &node, const char (&value)[N]) { assign(node, (const char *)value); }
+    template <size_t N>
+    static void assign(hostJson::Node &node, char (&value)[N]) { assign(node, (const char *)value); }
+};
+
+typedef JsonVariant JsonObject;
+typedef JsonVariant JsonArray;
+
+class JsonDocument : public JsonVariant
+{
+public:
+    JsonDocument() : JsonVariant(std::make_shared<hostJson::Node>()) {}
+
+    void clear() { *_node = hostJson::Node(); }
+
+    template <class T>
+    JsonDocument &operator=(const T &value)
+    {
+        JsonVariant::operator=(value);
+        return *this;
+    }
+};
+
+class DynamicJsonDocument : public JsonDocument
+{
+public:
+    explicit DynamicJsonDocument(size_t capacity) {}
+};
+
+template <size_t capacity>
+class StaticJsonDocument : public JsonDocument
+{
+};
+
+class DeserializationError
+{
+public:
+    enum Code
+    {
+        Ok,
+        EmptyInput,
+        IncompleteInput,
+        InvalidInput,
+        NoMemory,
+        TooDeep
+    };
+
+    DeserializationError(Code code = Ok) : _code(code) {}
+    explicit operator bool() const { return _code != Ok; }
+    bool operator==(Code code) const { return _code == code; }
+    Code code() const { return _code; }
+    const char *c_str() const
+    {
+        static const char *names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+        return names[_code];
+    }
+
+private:
+    Code _code;
+};
+
+namespace DeserializationOption
+{
+    class Filter
+    {
+    public:
+        explicit Filter(const JsonDocument &filter) : node(filter.node()) {}
+        std::shared_ptr<hostJson::Node> node;
+    };
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length);
+DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length, DeserializationOption::Filter filter);
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const String &input)
+{
+    return deserializeJson(doc, input.c_str(), input.length());
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input)
+{
+    return deserializeJson(doc, input, strlen(input));
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const String &input, DeserializationOption::Filter filter)
+{
+    return deserializeJson(doc, input.c_str(), input.length(), filter);
+}
+
+#endif
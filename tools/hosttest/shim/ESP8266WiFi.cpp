@@ -0,0 +1,216 @@
+// ESP8266WiFi shim for host tests, simulated access points and TCP peers.
+
+#include <ESP8266WiFi.h>
+#include <algorithm>
+
+WiFiClass WiFi;
+
+namespace host
+{
+    std::vector<Network> networks;
+    std::vector<WifiBegin> wifiBegins;
+    std::map<std::string, std::shared_ptr<TcpEndpoint>> endpoints;
+    std::vector<std::string> unresolvable;
+    uint32_t dnsMillis = 2;
+
+    void dropWifi()
+    {
+        WiFi.dropped = true;
+    }
+
+    std::shared_ptr<TcpEndpoint> addEndpoint(const std::string &name, uint16_t port)
+    {
+        std::shared_ptr<TcpEndpoint> endpoint = std::make_shared<TcpEndpoint>();
+        endpoints[name + ":" + std::to_string(port)] = endpoint;
+        return endpoint;
+    }
+
+    // Stable fake address per name.
+    static IPAddress resolve(const std::string &name)
+    {
+        return IPAddress(10, 0, 0, 1 + std::hash<std::string>()(name) % 250);
+    }
+}
+
+wl_status_t WiFiClass::begin(const String &ssid, const String &password, int32_t channel, const uint8_t *bssid, bool connect)
+{
+    network = -1;
+    dropped = false;
+    beginMicros = host::nowMicros;
+    fast = false;
+
+    for (size_t i = 0; i < host::networks.size(); i++)
+    {
+        if (host::networks[i].ssid == ssid.s)
+        {
+            network = i;
+            host::Network &n = host::networks[i];
+            fast = channel == n.channel && bssid && memcmp(bssid, n.bssid, 6) == 0;
+
+            // A wrong BSSID or channel means the access point is not found.
+            if ((channel || bssid) && !fast)
+            {
+                network = -2;
+            }
+            else if (n.password != password.s)
+            {
+                network = -3 - (int)i;
+            }
+        }
+    }
+
+    host::wifiBegins.push_back({ssid.s, channel, bssid != nullptr, staticAddress});
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns)
+{
+    staticAddress = (uint32_t)local != 0;
+    staticLocal = local;
+    staticGateway = gateway;
+    staticSubnet = subnet;
+    staticDns = dns;
+    return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+    if (beginMicros == 0 && network == -1)
+    {
+        return WL_IDLE_STATUS;
+    }
+
+    uint64_t elapsed = (host::nowMicros - beginMicros) / 1000;
+
+    if (network == -1 || network == -2)
+    {
+        return elapsed > 2000 ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+    }
+    if (network < -2)
+    {
+        return elapsed > 2000 ? WL_WRONG_PASSWORD : WL_DISCONNECTED;
+    }
+
+    host::Network &n = host::networks[network];
+    if (!n.up)
+    {
+        return dropped || elapsed > n.scanMillis ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+    }
+    if (dropped)
+    {
+        return WL_CONNECTION_LOST;
+    }
+
+    uint64_t connectMillis = (fast ? n.fastMillis : n.scanMillis) + (staticAddress ? 0 : n.dhcpMillis);
+    return elapsed >= connectMillis ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    network = -1;
+    beginMicros = 0;
+    return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    if (status() != WL_CONNECTED)
+    {
+        return IPAddress();
+    }
+    return staticAddress ? staticLocal : host::networks[network].address;
+}
+
+IPAddress WiFiClass::gatewayIP()
+{
+    if (status() != WL_CONNECTED)
+    {
+        return IPAddress();
+    }
+    return staticAddress ? staticGateway : host::networks[network].gateway;
+}
+
+IPAddress WiFiClass::subnetMask()
+{
+    return status() == WL_CONNECTED ? IPAddress(255, 255, 255, 0) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index)
+{
+    return gatewayIP();
+}
+
+uint8_t *WiFiClass::BSSID()
+{
+    static uint8_t none[6];
+    return status() == WL_CONNECTED ? host::networks[network].bssid : none;
+}
+
+int32_t WiFiClass::channel()
+{
+    return status() == WL_CONNECTED ? host::networks[network].channel : 0;
+}
+
+String WiFiClass::SSID()
+{
+    return status() == WL_CONNECTED ? String(host::networks[network].ssid) : String();
+}
+
+int WiFiClass::hostByName(const char *name, IPAddress &address)
+{
+    return hostByName(name, address, 10000);
+}
+
+int WiFiClass::hostByName(const char *name, IPAddress &address, uint32_t timeout)
+{
+    if (status() != WL_CONNECTED ||
+        std::find(host::unresolvable.begin(), host::unresolvable.end(), name) != host::unresolvable.end())
+    {
+        host::advanceMillis(timeout);
+        return 0;
+    }
+
+    host::advanceMillis(host::dnsMillis);
+    address = host::resolve(name);
+    return 1;
+}
+
+int WiFiClient::connect(const char *name, uint16_t port)
+{
+    IPAddress address;
+    if (!WiFi.hostByName(name, address, 10000))
+    {
+        return 0;
+    }
+    return connect(address, port);
+}
+
+int WiFiClient::connect(IPAddress address, uint16_t port)
+{
+    stop();
+
+    for (auto &entry : host::endpoints)
+    {
+        std::string name = entry.first.substr(0, entry.first.rfind(':'));
+        uint16_t endpointPort = atoi(entry.first.substr(entry.first.rfind(':') + 1).c_str());
+
+        if (host::resolve(name) == address && endpointPort == port && WiFi.status() == WL_CONNECTED)
+        {
+            if (!entry.second->accept)
+            {
+                break;
+            }
+
+            host::advanceMillis(entry.second->connectMillis);
+            _endpoint = entry.second;
+            _endpoint->open = true;
+            _endpoint->connects++;
+            _endpoint->fromClient.clear();
+            return 1;
+        }
+    }
+
+    // No answer, the connect blocks until the client timeout.
+    host::advanceMillis(_timeout);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// ESP8266WiFi shim for host tests
+//
+// Simulated access points (host::networks) with scan and fast connect
+// times on the virtual clock, name resolution and in-process TCP
+// endpoints (host::TcpEndpoint) for WiFiClient.
+
+#ifndef HOST_ESP8266_WIFI_H
+#define HOST_ESP8266_WIFI_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+typedef enum
+{
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+namespace host
+{
+    struct Network
+    {
+        std::string ssid;
+        std::string password;
+        uint8_t bssid[6];
+        int32_t channel;
+        bool up;
+        uint32_t scanMillis; // Connect time with a scan and DHCP.
+        uint32_t fastMillis; // Connect time with known channel and BSSID.
+        uint32_t dhcpMillis; // Added when the address comes from DHCP.
+        IPAddress address;   // Leased by DHCP.
+        IPAddress gateway;
+    };
+
+    extern std::vector<Network> networks;
+
+    // Connection attempts seen by WiFi.begin().
+    struct WifiBegin
+    {
+        std::string ssid;
+        int32_t channel;
+        bool bssid;
+        bool staticAddress;
+    };
+    extern std::vector<WifiBegin> wifiBegins;
+
+    void dropWifi(); // Lose the current connection.
+
+    // In-process TCP peer. Bytes in toClient are read by the WiFiClient,
+    // bytes it writes are appended to fromClient.
+    struct TcpEndpoint
+    {
+        bool accept = true;
+        uint32_t connectMillis = 5; // Time a connect blocks for.
+        bool open = false;
+        int connects = 0;
+        std::string toClient;
+        std::string fromClient;
+    };
+
+    // Endpoints by "name:port", names resolve to 10.0.0.x.
+    std::shared_ptr<TcpEndpoint> addEndpoint(const std::string &name, uint16_t port);
+    extern std::map<std::string, std::shared_ptr<TcpEndpoint>> endpoints;
+    extern std::vector<std::string> unresolvable; // Names that fail DNS.
+    extern uint32_t dnsMillis;                   // Time a lookup blocks for.
+}
+
+class WiFiClass
+{
+public:
+    wl_status_t begin(const String &ssid, const String &password = String(), int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true);
+    wl_status_t begin(const char *ssid, const char *password = nullptr, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true)
+    {
+        return begin(String(ssid), String(password), channel, bssid, connect);
+    }
+
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress((uint32_t)0));
+    wl_status_t status();
+    bool disconnect(bool wifiOff = false);
+
+    bool mode(WiFiMode_t mode) { return true; }
+    bool persistent(bool persistent) { return true; }
+    bool setAutoReconnect(bool autoReconnect) { return true; }
+    bool setAutoConnect(bool autoConnect) { return true; }
+
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t index = 0);
+    uint8_t *BSSID();
+    int32_t channel();
+    String SSID();
+
+    int hostByName(const char *name, IPAddress &address);
+    int hostByName(const char *name, IPAddress &address, uint32_t timeout);
+
+    // Simulation state.
+    int network = -1; // Index in host::networks of the attempt.
+    uint64_t beginMicros = 0;
+    bool fast = false;
+    bool staticAddress = false;
+    bool dropped = false;
+    IPAddress staticLocal, staticGateway, staticSubnet, staticDns;
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream
+{
+public:
+    int connect(IPAddress address, uint16_t port);
+    int connect(const char *name, uint16_t port);
+    int connect(const String &name, uint16_t port) { return connect(name.c_str(), port); }
+    uint8_t connected() { return _endpoint && _endpoint->open && WiFi.status() == WL_CONNECTED; }
+    void stop()
+    {
+        if (_endpoint)
+        {
+            _endpoint->open = false;
+            _endpoint.reset();
+        }
+    }
+    void setNoDelay(bool noDelay) {}
+    explicit operator bool() { return connected(); }
+
+    // Whether HTTPClient can make https requests through this client.
+    virtual bool httpsReady() { return false; }
+
+    size_t write(uint8_t c) override
+    {
+        if (!connected())
+        {
+            return 0;
+        }
+        _endpoint->fromClient += (char)c;
+        return 1;
+    }
+    using Print::write;
+
+    int available() override { return connected() ? _endpoint->toClient.size() : 0; }
+    int read() override
+    {
+        if (!available())
+        {
+            return -1;
+        }
+        uint8_t c = _endpoint->toClient[0];
+        _endpoint->toClient.erase(0, 1);
+        return c;
+    }
+    int read(uint8_t *buffer, size_t size) { return readBytes(buffer, size); }
+
+private:
+    std::shared_ptr<host::TcpEndpoint> _endpoint;
+};
+
+#endif
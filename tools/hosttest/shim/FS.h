@@ -0,0 +1,107 @@
+// File system shim for host tests
+//
+// Files live in memory (host::files) and stay there across SD.begin()
+// calls, so a test can prepare a card and read back what was written.
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+namespace host
+{
+    extern std::map<std::string, std::shared_ptr<std::string>> files;
+    extern bool sdPresent; // SD.begin() fails while false.
+}
+
+#define FILE_READ "r"
+#define FILE_WRITE "a+"
+
+namespace fs
+{
+    class File : public Stream
+    {
+    public:
+        File() {}
+        File(std::shared_ptr<std::string> data, size_t position, bool writable)
+            : _data(data), _position(position), _writable(writable) {}
+
+        explicit operator bool() const { return _data != nullptr; }
+        void close() { _data.reset(); }
+
+        size_t size() const { return _data ? _data->size() : 0; }
+        size_t position() const { return _position; }
+        bool seek(uint32_t position)
+        {
+            if (!_data || position > _data->size())
+            {
+                return false;
+            }
+            _position = position;
+            return true;
+        }
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *buffer, size_t size) override
+        {
+            if (!_data || !_writable)
+            {
+                return 0;
+            }
+            if (_position + size > _data->size())
+            {
+                _data->resize(_position + size);
+            }
+            memcpy(&(*_data)[_position], buffer, size);
+            _position += size;
+            return size;
+        }
+        using Print::write;
+
+        int available() override { return _data ? _data->size() - _position : 0; }
+        int read() override { return available() ? (uint8_t)(*_data)[_position++] : -1; }
+        int read(uint8_t *buffer, size_t size) { return readBytes(buffer, size); }
+        int peek() override { return available() ? (uint8_t)(*_data)[_position] : -1; }
+
+    private:
+        std::shared_ptr<std::string> _data;
+        size_t _position = 0;
+        bool _writable = false;
+    };
+
+    class FS
+    {
+    public:
+        bool exists(const char *path) { return host::files.count(path) != 0; }
+        bool remove(const char *path) { return host::files.erase(path) != 0; }
+
+        // Modes as fopen(): "r", "r+", "w", "w+", "a", "a+".
+        File open(const char *path, const char *mode)
+        {
+            if (!host::sdPresent)
+            {
+                return File();
+            }
+
+            auto entry = host::files.find(path);
+            if (mode[0] == 'r')
+            {
+                return entry == host::files.end() ? File() : File(entry->second, 0, mode[1] == '+');
+            }
+
+            if (entry == host::files.end() || mode[0] == 'w')
+            {
+                host::files[path] = std::make_shared<std::string>();
+            }
+            std::shared_ptr<std::string> data = host::files[path];
+            return File(data, mode[0] == 'a' ? data->size() : 0, true);
+        }
+        File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+    };
+}
+
+using fs::File;
+
+#endif
@@ -0,0 +1,13 @@
+// HTTP and NeoPixel shim state for host tests.
+
+#include <esp8266httpclient.h>
+#include <Adafruit_NeoPixel.h>
+
+namespace host
+{
+    std::function<HttpResponse(const std::string &url)> httpHandler;
+    std::vector<std::string> httpRequests;
+
+    std::function<void(Adafruit_NeoPixel &strip)> showHook;
+    uint32_t frames = 0;
+}
@@ -0,0 +1,22 @@
+// SD shim for host tests, backed by the in-memory files in FS.h.
+
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <FS.h>
+
+class SDClass
+{
+public:
+    bool begin(uint8_t csPin) { return host::sdPresent; }
+    bool exists(const char *path) { return host::files.count(path) != 0; }
+    File open(const char *path, const char *mode = FILE_READ) { return _fs.open(path, mode); }
+    File open(const String &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+
+private:
+    fs::FS _fs;
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,10 @@
+// SDFS shim for host tests.
+
+#ifndef HOST_SDFS_H
+#define HOST_SDFS_H
+
+#include <FS.h>
+
+extern fs::FS SDFS;
+
+#endif
@@ -0,0 +1,16 @@
+// SPI shim for host tests, the SD shim does not use a bus.
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass
+{
+public:
+    void begin() {}
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,15 @@
+// SD, SDFS and SPI shims for host tests.
+
+#include <SD.h>
+#include <SDFS.h>
+#include <SPI.h>
+
+SPIClass SPI;
+fs::FS SDFS;
+SDClass SD;
+
+namespace host
+{
+    std::map<std::string, std::shared_ptr<std::string>> files;
+    bool sdPresent = true;
+}
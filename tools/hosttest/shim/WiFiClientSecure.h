@@ -0,0 +1,21 @@
+// WiFiClientSecure shim for host tests
+//
+// TLS is not simulated. A client can make https requests once it trusts
+// the server, here only through setInsecure().
+
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include <ESP8266WiFi.h>
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+    void setInsecure() { _insecure = true; }
+    bool httpsReady() override { return _insecure; }
+
+private:
+    bool _insecure = false;
+};
+
+#endif
@@ -0,0 +1,120 @@
+// WiFiUDP shim for host tests, one in-process LAN.
+
+#include <WiFiUdp.h>
+#include <ESP8266WiFi.h>
+#include <algorithm>
+
+namespace host
+{
+    uint32_t udpSent = 0;
+    uint32_t udpDropped = 0;
+    uint32_t udpDropEvery = 0;
+
+    static std::vector<WiFiUDP *> &sockets()
+    {
+        static std::vector<WiFiUDP *> all;
+        return all;
+    }
+}
+
+WiFiUDP::WiFiUDP()
+{
+    host::sockets().push_back(this);
+}
+
+WiFiUDP::~WiFiUDP()
+{
+    std::vector<WiFiUDP *> &all = host::sockets();
+    all.erase(std::remove(all.begin(), all.end(), this), all.end());
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    _port = port;
+    _group = IPAddress();
+    _listening = WiFi.status() == WL_CONNECTED;
+    return _listening;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress interfaceAddress, IPAddress multicast, uint16_t port)
+{
+    _port = port;
+    _group = multicast;
+    _listening = WiFi.status() == WL_CONNECTED;
+    return _listening;
+}
+
+void WiFiUDP::stop()
+{
+    _listening = false;
+    _queue.clear();
+}
+
+int WiFiUDP::beginPacketMulticast(IPAddress multicast, uint16_t port, IPAddress interfaceAddress, int ttl)
+{
+    return beginPacket(multicast, port);
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port)
+{
+    _toAddress = address;
+    _toPort = port;
+    _outgoing.clear();
+    return WiFi.status() == WL_CONNECTED;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
+{
+    _outgoing.append((const char *)buffer, size);
+    return size;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        return 0;
+    }
+
+    host::udpSent++;
+    if (host::udpDropEvery && host::udpSent % host::udpDropEvery == 0)
+    {
+        host::udpDropped++;
+        return 1;
+    }
+
+    for (WiFiUDP *socket : host::sockets())
+    {
+        if (socket != this && socket->_listening && socket->_port == _toPort && socket->_group == _toAddress)
+        {
+            socket->_queue.push_back(_outgoing);
+        }
+    }
+    return 1;
+}
+
+int WiFiUDP::parsePacket()
+{
+    if (_queue.empty())
+    {
+        return 0;
+    }
+
+    _current = _queue.front();
+    _queue.pop_front();
+    _read = 0;
+    return _current.size();
+}
+
+int WiFiUDP::read()
+{
+    return available() ? (uint8_t)_current[_read++] : -1;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t length)
+{
+    size_t n = min(length, (size_t)available());
+    memcpy(buffer, _current.data() + _read, n);
+    _read += n;
+    return n;
+}
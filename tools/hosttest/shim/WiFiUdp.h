@@ -0,0 +1,58 @@
+// WiFiUDP shim for host tests
+//
+// Every WiFiUDP in the process shares one simulated LAN: a multicast
+// packet reaches all other sockets that joined its group and port, so
+// several clock instances can run against each other in one test.
+
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace host
+{
+    extern uint32_t udpSent;
+    extern uint32_t udpDropped;
+    extern uint32_t udpDropEvery; // Lose every nth packet sent, 0 for none.
+}
+
+class WiFiUDP
+{
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+    WiFiUDP(const WiFiUDP &) = delete;
+    WiFiUDP &operator=(const WiFiUDP &) = delete;
+
+    uint8_t begin(uint16_t port);
+    uint8_t beginMulticast(IPAddress interfaceAddress, IPAddress multicast, uint16_t port);
+    void stop();
+
+    int beginPacketMulticast(IPAddress multicast, uint16_t port, IPAddress interfaceAddress, int ttl = 1);
+    int beginPacket(IPAddress address, uint16_t port);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size);
+    int endPacket();
+
+    int parsePacket();
+    int available() { return _current.size() - _read; }
+    int read();
+    int read(uint8_t *buffer, size_t length);
+    int read(char *buffer, size_t length) { return read((uint8_t *)buffer, length); }
+
+private:
+    uint16_t _port = 0;
+    IPAddress _group;
+    bool _listening = false;
+    IPAddress _toAddress;
+    uint16_t _toPort = 0;
+    std::string _outgoing;
+    std::deque<std::string> _queue;
+    std::string _current;
+    size_t _read = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+// ESP8266HTTPClient shim for host tests
+//
+// Requests go to host::httpHandler, which returns the status and body
+// for a URL and how long the request takes on the virtual clock. Every
+// request is recorded in host::httpRequests.
+//
+// As on the device, https needs a client that can make it (begin(client,
+// url) with a WiFiClientSecure), and a request through a client first
+// connects it to the URL's host endpoint (host::addEndpoint) unless it
+// is still open. With setReuse(true) end() keeps the connection open.
+
+#ifndef HOST_ESP8266_HTTP_CLIENT_H
+#define HOST_ESP8266_HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <functional>
+#include <vector>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+namespace host
+{
+    struct HttpResponse
+    {
+        int code;
+        std::string body;
+        uint32_t latencyMillis;
+    };
+
+    extern std::function<HttpResponse(const std::string &url)> httpHandler;
+    extern std::vector<std::string> httpRequests;
+}
+
+class HTTPClient
+{
+public:
+    bool begin(const String &url)
+    {
+        _url = url.s;
+        _client = nullptr;
+        return true;
+    }
+    bool begin(WiFiClient &client, const String &url)
+    {
+        begin(url);
+        _client = &client;
+        return true;
+    }
+    void end()
+    {
+        if (_client && !_reuse)
+        {
+            _client->stop();
+        }
+    }
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeout) { _timeout = timeout; }
+    void addHeader(const String &name, const String &value) {}
+
+    int GET()
+    {
+        host::httpRequests.push_back(_url);
+
+        bool https = _url.compare(0, 8, "https://") == 0;
+        if (WiFi.status() != WL_CONNECTED || !host::httpHandler || (https && (!_client || !_client->httpsReady())) ||
+            (_client && !_client->connected() && !_client->connect(host().c_str(), https ? 443 : 80)))
+        {
+            _body.clear();
+            return HTTPC_ERROR_CONNECTION_FAILED;
+        }
+
+        host::HttpResponse response = host::httpHandler(_url);
+        host::advanceMillis(min(response.latencyMillis, (uint32_t)_timeout));
+        if (response.latencyMillis > _timeout)
+        {
+            _body.clear();
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+
+        _body = response.body;
+        return response.code;
+    }
+
+    String getString() { return String(_body); }
+    int getSize() { return _body.size(); }
+
+private:
+    std::string _url;
+    WiFiClient *_client = nullptr;
+    bool _reuse = false;
+    std::string _body;
+    uint16_t _timeout = 5000;
+
+    // Host name of the URL, the port is taken from the scheme.
+    std::string host()
+    {
+        size_t start = _url.find("://") == std::string::npos ? 0 : _url.find("://") + 3;
+        return _url.substr(start, _url.find_first_of(":/", start) - start);
+    }
+};
+
+#endif
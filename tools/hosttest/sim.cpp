@@ -0,0 +1,110 @@
+// Runs the firmware on the virtual clock, see simulator.h.
+//
+//   sim [--days N | --hours N] [--card DIR] [--script FILE]
+//       [--frames FILE] [--trace FILE] [--log FILE]
+//       [--start-millis MS] [--max-step MS]
+//
+// --card defaults to ../../sd-card, --start-millis sets millis() at power
+// on, e.g. 4294000000 to cross the 32 bit rollover early.
+
+#include "simulator.h"
+#include <chrono>
+
+static FILE *openOutput(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot write %s\n", path);
+        exit(2);
+    }
+    return file;
+}
+
+int main(int argc, char **argv)
+{
+    simulator sim;
+    double hours = 24;
+    const char *card = "../../sd-card";
+    const char *script = nullptr;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "--days") == 0)
+        {
+            hours = atof(value) * 24;
+        }
+        else if (strcmp(argv[i], "--hours") == 0)
+        {
+            hours = atof(value);
+        }
+        else if (strcmp(argv[i], "--card") == 0)
+        {
+            card = value;
+        }
+        else if (strcmp(argv[i], "--script") == 0)
+        {
+            script = value;
+        }
+        else if (strcmp(argv[i], "--frames") == 0)
+        {
+            sim.frameOutput = openOutput(value);
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            sim.traceOutput = openOutput(value);
+        }
+        else if (strcmp(argv[i], "--log") == 0)
+        {
+            sim.logOutput = openOutput(value);
+        }
+        else if (strcmp(argv[i], "--start-millis") == 0)
+        {
+            host::setMillis(strtoul(value, nullptr, 0));
+        }
+        else if (strcmp(argv[i], "--max-step") == 0)
+        {
+            sim.maxIdleStepMillis = atoi(value);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (!sim.loadCard(card))
+    {
+        fprintf(stderr, "Cannot read card %s\n", card);
+        return 2;
+    }
+    if (script && !sim.loadScript(script))
+    {
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sim.run(hours * 3600e3);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const SimStats &stats = sim.stats();
+    printf("Simulated %.1f h in %.1f s\n", sim.uptimeMillis() / 3600e3, seconds);
+    printf("Passes: %llu (%llu idle), worst pass %.1f ms\n", (unsigned long long)stats.passes,
+           (unsigned long long)stats.idlePasses, stats.worstPassMicros / 1000.0);
+    printf("Frames: %llu (%llu changed)\n", (unsigned long long)stats.frames, (unsigned long long)stats.changedFrames);
+    printf("HTTP requests: %llu (%llu failed)\n", (unsigned long long)stats.httpRequests,
+           (unsigned long long)stats.httpFailures);
+    printf("Log lines: %llu (%llu warnings, %llu errors)\n", (unsigned long long)stats.logLines,
+           (unsigned long long)stats.warnings, (unsigned long long)stats.errors);
+    printf("Free heap: %u (min %u)\n", stats.freeHeap, stats.minFreeHeap);
+
+    for (FILE *file : {sim.frameOutput, sim.traceOutput, sim.logOutput})
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+    return 0;
+}
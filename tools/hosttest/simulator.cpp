@@ -0,0 +1,549 @@
+// Virtual-time simulator, see simulator.h.
+
+#include "simulator.h"
+#include "tickLogFormat.h"
+#include <ArduinoJson.h>
+#include <Adafruit_NeoPixel.h>
+#include <ESP8266WiFi.h>
+#include <SD.h>
+#include <WiFiUdp.h>
+#include <dirent.h>
+#include <malloc.h>
+#include <new>
+
+// From firmware/src/main.cpp.
+void setup();
+void loop();
+
+const uint8_t buttonPin = 2; // buttonSelect, active low.
+
+// Live heap bytes, the firmware's heap use is what it holds beyond the
+// simulated SD card's contents.
+static int64_t liveBytes = 0;
+
+// Out of line, so the compiler does not pair a new with free().
+__attribute__((noinline)) static void *countedAlloc(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    liveBytes += malloc_usable_size(p);
+    return p;
+}
+
+__attribute__((noinline)) static void countedFree(void *p)
+{
+    if (p)
+    {
+        liveBytes -= malloc_usable_size(p);
+        free(p);
+    }
+}
+
+void *operator new(size_t size)
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p, size_t size) noexcept
+{
+    countedFree(p);
+}
+
+static int64_t firmwareHeapBytes()
+{
+    int64_t bytes = liveBytes;
+    for (const auto &file : host::files)
+    {
+        if (file.second->capacity() > 15)
+        {
+            bytes -= malloc_usable_size((void *)file.second->data());
+        }
+    }
+    return bytes;
+}
+
+static simulator *current = nullptr;
+
+// From delay() or yield() in the firmware: scripted input only.
+void simulator::idle()
+{
+    if (current && current->_started)
+    {
+        current->fireDueEvents();
+    }
+}
+
+simulator::simulator()
+{
+    prices["XAU"] = 2050;
+    prices["XAG"] = 23;
+    prices["XPT"] = 900;
+    prices["XPD"] = 1000;
+}
+
+uint64_t simulator::parseTime(const std::string &text)
+{
+    const char *p = text.c_str();
+    double total = 0;
+
+    while (*p)
+    {
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p)
+        {
+            return UINT64_MAX;
+        }
+        p = end;
+
+        if (strncmp(p, "ms", 2) == 0)
+        {
+            p += 2;
+        }
+        else if (*p == 's' || *p == 'm' || *p == 'h' || *p == 'd')
+        {
+            value *= *p == 's' ? 1e3 : *p == 'm' ? 60e3 : *p == 'h' ? 3600e3 : 86400e3;
+            p++;
+        }
+        else if (*p)
+        {
+            return UINT64_MAX;
+        }
+        total += value;
+    }
+    return total;
+}
+
+bool simulator::loadCard(const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        return false;
+    }
+
+    host::files.clear();
+    while (dirent *entry = readdir(dir))
+    {
+        std::string path = std::string(directory) + "/" + entry->d_name;
+        FILE *file = entry->d_name[0] != '.' ? fopen(path.c_str(), "rb") : nullptr;
+        if (!file)
+        {
+            continue;
+        }
+
+        std::shared_ptr<std::string> data = std::make_shared<std::string>();
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            data->append(buffer, n);
+        }
+        fclose(file);
+        host::files[std::string("/") + entry->d_name] = data;
+    }
+    closedir(dir);
+    return true;
+}
+
+bool simulator::addEvent(const std::string &line)
+{
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < line.size() && line[i] != '#')
+    {
+        size_t start = line.find_first_not_of(" \t\r\n", i);
+        if (start == std::string::npos || line[start] == '#')
+        {
+            break;
+        }
+        i = line.find_first_of(" \t\r\n", start);
+        words.push_back(line.substr(start, i - start));
+    }
+
+    if (words.empty())
+    {
+        return true;
+    }
+
+    Event event = {parseTime(words[0]), std::vector<std::string>(words.begin() + 1, words.end())};
+    if (event.atMillis == UINT64_MAX || event.words.empty())
+    {
+        return false;
+    }
+
+    const std::string &command = event.words[0];
+    size_t args = event.words.size() - 1;
+    bool valid = (command == "wifi" && args >= 1) || (command == "http" && args >= 1) ||
+                 (command == "price" && args == 2) || (command == "button" && args == 1);
+    if (!valid)
+    {
+        return false;
+    }
+
+    // A press is two pin changes.
+    if (command == "button")
+    {
+        Event release = {event.atMillis + parseTime(event.words[1]), {"pin", "1"}};
+        event.words = {"pin", "0"};
+        _events.push_back(release);
+    }
+    _events.push_back(event);
+
+    std::stable_sort(_events.begin() + _nextEvent, _events.end(),
+                     [](const Event &a, const Event &b) { return a.atMillis < b.atMillis; });
+    return true;
+}
+
+bool simulator::loadScript(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[256];
+    int number = 0;
+    bool valid = true;
+    while (fgets(line, sizeof(line), file))
+    {
+        number++;
+        if (!addEvent(line))
+        {
+            fprintf(stderr, "%s:%d: invalid event: %s", path, number, line);
+            valid = false;
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+uint64_t simulator::uptimeMillis()
+{
+    return _started ? (host::nowMicros - _powerOnMicros) / 1000 : 0;
+}
+
+void simulator::setWifi(const std::string &ssid, bool up)
+{
+    for (host::Network &network : host::networks)
+    {
+        if (ssid.empty() || network.ssid == ssid)
+        {
+            if (!up && network.up && WiFi.SSID().s == network.ssid)
+            {
+                host::dropWifi();
+            }
+            network.up = up;
+        }
+    }
+}
+
+void simulator::fire(const Event &event)
+{
+    const std::vector<std::string> &w = event.words;
+
+    if (w[0] == "wifi")
+    {
+        setWifi(w.size() > 2 ? w[2] : "", w[1] == "up");
+    }
+    else if (w[0] == "http")
+    {
+        if (w[1] == "latency" && w.size() > 2)
+        {
+            httpLatencyMillis = atoi(w[2].c_str());
+        }
+        else
+        {
+            for (const char *service : {"time", "spot", "fx"})
+            {
+                if (w.size() < 3 || w[2] == service)
+                {
+                    httpUp[service] = w[1] == "up";
+                }
+            }
+        }
+    }
+    else if (w[0] == "price")
+    {
+        prices[w[1]] = atof(w[2].c_str());
+    }
+    else if (w[0] == "pin")
+    {
+        host::setPin(buttonPin, atoi(w[1].c_str()));
+    }
+    _eventFired = true;
+}
+
+void simulator::fireDueEvents()
+{
+    while (_nextEvent < _events.size() && _events[_nextEvent].atMillis <= uptimeMillis())
+    {
+        fire(_events[_nextEvent++]);
+    }
+}
+
+host::HttpResponse simulator::serve(const std::string &url)
+{
+    _stats.httpRequests++;
+    _intervalHttp++;
+
+    // Each request takes 80-120% of the configured latency.
+    uint32_t latency = httpLatencyMillis * (80 + random(41)) / 100;
+
+    size_t api = url.find("/api/");
+    const char *service = url.find("worldclockapi.com") != std::string::npos ? "time"
+                          : api != std::string::npos                         ? "spot"
+                          : url.find("/latest/USD") != std::string::npos     ? "fx"
+                                                                             : "";
+    _stats.spotRequests += strcmp(service, "spot") == 0;
+    _stats.fxRequests += strcmp(service, "fx") == 0;
+
+    if (!httpUp[service])
+    {
+        _stats.httpFailures++;
+        return {HTTPC_ERROR_CONNECTION_FAILED, "", latency};
+    }
+
+    char body[256];
+
+    if (strcmp(service, "time") == 0)
+    {
+        // Power on is 2024-01-01 00:00 local time.
+        uint64_t minutes = uptimeMillis() / 60000;
+        int year, month, day;
+        CivilFromDays(DaysFromCivil(2024, 1, 1) + minutes / 1440, &year, &month, &day);
+        snprintf(body, sizeof(body), "{\"currentDateTime\": \"%04d-%02d-%02dT%02d:%02d-05:00\"}",
+                 year, month, day, (int)(minutes / 60 % 24), (int)(minutes % 60));
+        return {200, body, latency};
+    }
+
+    if (strcmp(service, "spot") == 0)
+    {
+        // https://<host>/api/XAU_USD/USD, random walk of up to priceWalk per request.
+        std::string pair = url.substr(api + 5, url.find('/', api + 5) - api - 5);
+        std::string symbol = pair.substr(0, pair.find('_'));
+        if (!prices.count(symbol))
+        {
+            return {404, "{}", latency};
+        }
+
+        double &price = prices[symbol];
+        price *= 1 + priceWalk * (random(2001) - 1000) / 1000;
+        snprintf(body, sizeof(body), "{\"results\": {\"%s\": {\"data\": [[0, %.4f]]}}}", pair.c_str(), price);
+        return {200, body, latency};
+    }
+
+    if (strcmp(service, "fx") == 0)
+    {
+        return {200, "{\"rates\": {\"USD\": 1, \"EUR\": 0.92, \"GBP\": 0.79, \"CHF\": 0.88, \"JPY\": 148.2, \"CAD\": 1.35}}", latency};
+    }
+
+    return {404, "", latency};
+}
+
+// The access points named on the card are up.
+void simulator::addNetworks()
+{
+    DynamicJsonDocument doc(4096);
+    std::shared_ptr<std::string> card = host::files.count("/wifi.txt") ? host::files["/wifi.txt"] : nullptr;
+    if (card && !deserializeJson(doc, card->c_str()))
+    {
+        std::vector<std::pair<String, String>> names = {{doc["ssid"].as<String>(), doc["password"].as<String>()}};
+        for (JsonObject entry : doc["networks"].as<JsonArray>())
+        {
+            names.push_back({entry["ssid"].as<String>(), entry["password"].as<String>()});
+        }
+
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            host::Network network = {names[i].first.s, names[i].second.s, {0x02, 0, 0, 0, 0, (uint8_t)i},
+                                     (int32_t)(1 + i * 5 % 11), true, 3000, 800, 500,
+                                     IPAddress(192, 168, 1, 50 + i), IPAddress(192, 168, 1, 1)};
+            host::networks.push_back(network);
+        }
+    }
+}
+
+// API hosts, connections are opened by the firmware's HTTP clients.
+void simulator::addServers()
+{
+    host::addEndpoint("worldclockapi.com", 80)->connectMillis = 50;
+    host::addEndpoint("open.er-api.com", 80)->connectMillis = 50;
+    _spotServer = host::addEndpoint("www.goldapi.io", 443);
+    _spotServer->connectMillis = 400; // TCP and TLS handshake.
+}
+
+uint64_t simulator::activity()
+{
+    return Serial.output.size() + _stats.httpRequests + host::udpSent;
+}
+
+void simulator::collectOutput()
+{
+    for (char c : Serial.output)
+    {
+        if (_lineStart)
+        {
+            _stats.logLines++;
+            _stats.warnings += c == 'W';
+            _stats.errors += c == 'E';
+        }
+        _lineStart = c == '\n';
+    }
+
+    if (logOutput)
+    {
+        fwrite(Serial.output.data(), 1, Serial.output.size(), logOutput);
+    }
+    Serial.output.clear();
+    host::httpRequests.clear();
+    host::wifiBegins.clear();
+}
+
+void simulator::updateHeap()
+{
+    int64_t freeHeap = heapSize - (firmwareHeapBytes() - _heapAtPowerOn);
+    _stats.freeHeap = constrain(freeHeap, 0, (int64_t)UINT32_MAX);
+    _stats.minFreeHeap = min(_stats.minFreeHeap, _stats.freeHeap);
+    ESP.freeHeap = _stats.freeHeap;
+}
+
+void simulator::trace()
+{
+    if (traceOutput)
+    {
+        if (_nextTraceMillis == 60000)
+        {
+            fprintf(traceOutput, "minute,free_heap,worst_pass_us,frames,http_requests,log_lines\n");
+        }
+        fprintf(traceOutput, "%llu,%u,%llu,%llu,%llu,%llu\n", (unsigned long long)(_nextTraceMillis / 60000),
+                _stats.freeHeap, (unsigned long long)_intervalWorstPassMicros, (unsigned long long)_intervalFrames,
+                (unsigned long long)_intervalHttp, (unsigned long long)_stats.logLines);
+    }
+
+    _intervalWorstPassMicros = 0;
+    _intervalFrames = 0;
+    _intervalHttp = 0;
+    _nextTraceMillis += 60000;
+}
+
+void simulator::run(uint64_t millis)
+{
+    current = this;
+    host::idleHook = idle;
+    host::httpHandler = [this](const std::string &url) { return serve(url); };
+    host::showHook = [this](Adafruit_NeoPixel &strip) {
+        _stats.frames++;
+        _intervalFrames++;
+
+        std::vector<uint8_t> &last = _frames[strip.getPin()];
+        size_t size = strip.numPixels() * 3;
+        if (last.size() == size && memcmp(last.data(), strip.getPixels(), size) == 0)
+        {
+            return;
+        }
+
+        last.assign(strip.getPixels(), strip.getPixels() + size);
+        _stats.changedFrames++;
+        if (frameOutput)
+        {
+            fprintf(frameOutput, "%llu %d ", (unsigned long long)uptimeMillis(), strip.getPin());
+            for (uint8_t byte : last)
+            {
+                fprintf(frameOutput, "%02x", byte);
+            }
+            fprintf(frameOutput, "\n");
+        }
+    };
+
+    if (!_started)
+    {
+        addNetworks();
+        addServers();
+        _heapAtPowerOn = firmwareHeapBytes();
+        _powerOnMicros = host::nowMicros;
+        _stats.minFreeHeap = heapSize;
+        _started = true;
+
+        // GPIO2 is pulled up on the board, the button is released.
+        host::setPin(buttonPin, HIGH);
+
+        fireDueEvents();
+        setup();
+        collectOutput();
+        updateHeap();
+    }
+
+    uint64_t end = uptimeMillis() + millis;
+    uint64_t idleStep = 1000;
+
+    while (uptimeMillis() < end)
+    {
+        _eventFired = false;
+        fireDueEvents();
+
+        uint64_t activityBefore = activity();
+        uint64_t start = host::nowMicros;
+
+        loop();
+
+        uint64_t pass = host::nowMicros - start;
+        _stats.passes++;
+        _stats.worstPassMicros = max(_stats.worstPassMicros, pass);
+        _intervalWorstPassMicros = max(_intervalWorstPassMicros, pass);
+
+        bool busy = _eventFired || activity() != activityBefore;
+        collectOutput();
+        updateHeap();
+
+        // Fast-forward after idle passes, never past the next event.
+        uint64_t step = passMicros;
+        if (busy)
+        {
+            idleStep = 1000;
+        }
+        else
+        {
+            _stats.idlePasses++;
+            step = max(step, idleStep);
+            idleStep = min(idleStep * 2, (uint64_t)maxIdleStepMillis * 1000);
+        }
+
+        if (_nextEvent < _events.size())
+        {
+            uint64_t eventMicros = _powerOnMicros + _events[_nextEvent].atMillis * 1000;
+            step = min(step, eventMicros > host::nowMicros ? eventMicros - host::nowMicros : 0);
+        }
+        step = min(step, _powerOnMicros + end * 1000 - min(host::nowMicros, _powerOnMicros + end * 1000));
+        host::advance(step);
+
+        while (uptimeMillis() >= _nextTraceMillis)
+        {
+            trace();
+        }
+    }
+}
@@ -0,0 +1,134 @@
+// Virtual-time simulator
+//
+// Runs the firmware's setup() and loop() against the shim on the virtual
+// clock. Passes that do no work (no log output, network traffic or
+// scripted input) fast-forward: the idle step doubles up to a limit and
+// never passes the next scripted event, so weeks of uptime run in
+// seconds. Scripted events also fire while the firmware blocks in
+// delay() or yield().
+//
+// The simulated world serves the time, spot and FX APIs from a price
+// random walk (the spot API over https, with a 400 ms connect), brings up the Wi-Fi networks named on the SD card and
+// takes scripted input, one event per line:
+//
+//   <time> wifi down|up [ssid]     Access point off or on (all by default).
+//   <time> http down|up [service]  Requests to the time, spot or fx service
+//                                  (all by default) fail or work again.
+//   <time> http latency <ms>       Time each HTTP request takes.
+//   <time> price <symbol> <price>  Jump a price.
+//   <time> button <ms>             Press the select button for ms.
+//
+// Times are since power on, e.g. 90s, 2h30m, 45d, "#" starts a comment.
+//
+// Every changed strip frame can be written out, and a trace line with
+// heap, pass latency and traffic is kept per simulated minute.
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <Arduino.h>
+#include <esp8266httpclient.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SimStats
+{
+    uint64_t passes;
+    uint64_t idlePasses;
+    uint64_t frames;        // show() calls.
+    uint64_t changedFrames; // Frames that differ from the strip's previous one.
+    uint64_t httpRequests;
+    uint64_t httpFailures;
+    uint64_t spotRequests; // Requests per service, failed ones included.
+    uint64_t fxRequests;
+    uint64_t spotConnects; // Connections opened to the spot API.
+    uint64_t logLines;
+    uint64_t warnings;
+    uint64_t errors;
+    uint64_t worstPassMicros; // Longest loop() pass, in virtual time.
+    uint32_t minFreeHeap;
+    uint32_t freeHeap;
+};
+
+class simulator
+{
+public:
+    uint32_t passMicros = 200;       // Virtual time of a loop() pass that did work.
+    uint32_t maxIdleStepMillis = 250; // Longest fast-forward after an idle pass.
+    uint32_t heapSize = 50000;       // Free heap before setup().
+
+    FILE *frameOutput = nullptr; // "<ms> <pin> <GRB hex>" per changed frame.
+    FILE *traceOutput = nullptr; // CSV line per simulated minute.
+    FILE *logOutput = nullptr;   // Serial output.
+
+    simulator();
+
+    // Copy the files of a directory onto the simulated SD card.
+    bool loadCard(const char *directory);
+
+    // Add scripted events from a file or a single line.
+    bool loadScript(const char *path);
+    bool addEvent(const std::string &line);
+
+    // Run for a while, setup() is called on the first run.
+    void run(uint64_t millis);
+
+    // Virtual milliseconds since power on.
+    uint64_t uptimeMillis();
+
+    const SimStats &stats()
+    {
+        _stats.spotConnects = _spotServer ? _spotServer->connects : 0;
+        return _stats;
+    }
+
+    // Last frame shown on the strip at a pin, GRB bytes.
+    const std::vector<uint8_t> &frame(int16_t pin) { return _frames[pin]; }
+
+    std::map<std::string, double> prices;
+    double priceWalk = 0.001; // Largest relative price step per request.
+    uint32_t httpLatencyMillis = 300;
+    std::map<std::string, bool> httpUp = {{"time", true}, {"spot", true}, {"fx", true}};
+
+    static uint64_t parseTime(const std::string &text);
+
+private:
+    struct Event
+    {
+        uint64_t atMillis;
+        std::vector<std::string> words;
+    };
+
+    std::vector<Event> _events; // Sorted by time.
+    size_t _nextEvent = 0;
+    bool _started = false;
+    bool _eventFired = false;
+    bool _lineStart = true; // Serial output is at the start of a line.
+    uint64_t _powerOnMicros;
+    uint64_t _nextTraceMillis = 60000;
+    int64_t _heapAtPowerOn;
+    SimStats _stats = {};
+    std::map<int16_t, std::vector<uint8_t>> _frames;
+    std::shared_ptr<host::TcpEndpoint> _spotServer;
+
+    // Per trace interval.
+    uint64_t _intervalWorstPassMicros = 0;
+    uint64_t _intervalHttp = 0;
+    uint64_t _intervalFrames = 0;
+
+    static void idle();
+    void fireDueEvents();
+    void fire(const Event &event);
+    void addNetworks();
+    void addServers();
+    void setWifi(const std::string &ssid, bool up);
+    host::HttpResponse serve(const std::string &url);
+    void collectOutput();
+    void updateHeap();
+    void trace();
+    uint64_t activity();
+};
+
+#endif
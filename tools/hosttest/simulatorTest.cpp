@@ -0,0 +1,287 @@
+// Simulator tests: one device runs through the tests in order on the
+// virtual clock, from power on shortly before the 32 bit millis()
+// rollover through a week of uptime, with scripted outages and input.
+
+#include "hostTest.h"
+#include "simulator.h"
+#include "layout.h"
+#include "logger.h"
+#include <ESP8266WiFi.h>
+#include <chrono>
+
+// From firmware/src/main.cpp.
+void GenerateNumbers(float value, int *numbers, int *dot);
+float ConvertPrice(float usdPrice, int currency);
+
+static const int16_t stripPins[layout::stripCount] = {5, 4, 0};
+// Instruments and currencies on the SD card, the display steps through
+// every currency of an instrument before the next instrument.
+static const char *symbols[] = {"XAU", "XAG", "XPT"};
+const int currencyCount = 3;
+const int selectionCount = 3 * currencyCount;
+
+static simulator sim;
+
+// Schedule an event relative to now.
+static void after(uint64_t millis, const std::string &event)
+{
+    CHECK(sim.addEvent(std::to_string(sim.uptimeMillis() + millis) + " " + event));
+}
+
+// Lit segments of each digit in the last frames, bit n is segment n.
+static std::vector<uint8_t> displayedSegments()
+{
+    std::vector<uint8_t> digits(layout::digitCount, 0);
+    for (int i = 0; i < layout::segmentPixelCount; i++)
+    {
+        PixelRef pixel = layout::segments.pixel[i];
+        const std::vector<uint8_t> &frame = sim.frame(stripPins[pixel.strip]);
+        size_t at = pixel.index * 3;
+        if (at + 2 < frame.size() && (frame[at] || frame[at + 1] || frame[at + 2]))
+        {
+            digits[i / layout::pixelsPerDigit] |= 1 << (i % layout::pixelsPerDigit / layout::pixelsPerSegment);
+        }
+    }
+    return digits;
+}
+
+// GRB bytes of the first lit digit pixel, 0 for none.
+static uint32_t litSegmentColor()
+{
+    for (int i = 0; i < layout::segmentPixelCount; i++)
+    {
+        PixelRef pixel = layout::segments.pixel[i];
+        const std::vector<uint8_t> &frame = sim.frame(stripPins[pixel.strip]);
+        size_t at = pixel.index * 3;
+        if (at + 2 < frame.size() && (frame[at] || frame[at + 1] || frame[at + 2]))
+        {
+            return frame[at] << 16 | frame[at + 1] << 8 | frame[at + 2];
+        }
+    }
+    return 0;
+}
+
+// Instrument and currency (instrument * currencyCount + currency) whose
+// latest served price is on the display, -1 for none.
+static int displayedSelection()
+{
+    std::vector<uint8_t> shown = displayedSegments();
+    for (int s = 0; s < selectionCount; s++)
+    {
+        int numbers[5];
+        int dot;
+        GenerateNumbers(ConvertPrice(sim.prices[symbols[s / currencyCount]], s % currencyCount), numbers, &dot);
+
+        // Same digits, blank digits included.
+        static const uint8_t segmentValues[12] = {0x3f, 0x18, 0x6d, 0x7c, 0x5a, 0x76, 0x73, 0x1c, 0x7f, 0x5e, 0, 0x40};
+        bool match = true;
+        for (int d = 0; d < layout::digitCount; d++)
+        {
+            match = match && shown[d] == segmentValues[numbers[d]];
+        }
+        if (match)
+        {
+            return s;
+        }
+    }
+    return -1;
+}
+
+TEST(bootsAcrossMillisRolloverAndShowsPrices)
+{
+    CHECK(sim.loadCard("../../sd-card"));
+
+    // Steady prices below the card's alert levels, so the display is not
+    // flashing and shows what was served.
+    sim.priceWalk = 0;
+    sim.prices["XAU"] = 1900;
+
+    // The FX service is down for the first minutes.
+    CHECK(sim.addEvent("0 http down fx"));
+    CHECK(sim.addEvent("6m http up fx"));
+
+    // Power on 2 minutes before millis() wraps.
+    host::setMillis(0xFFFFFFFFu - 120000);
+    sim.run(5 * 60000);
+
+    CHECK_EQ(WiFi.status(), WL_CONNECTED);
+    CHECK(sim.stats().spotRequests >= 3);
+    CHECK(sim.stats().changedFrames > 0);
+    CHECK_EQ(sim.stats().errors, 0u);
+    CHECK(displayedSelection() >= 0);
+}
+
+TEST(fxRatesAreRetriedUntilTheFirstTable)
+{
+    // Retried about once a minute while down, the configured refresh is an hour.
+    CHECK(sim.stats().fxRequests >= 4);
+    CHECK_EQ(ConvertPrice(1000, 1), 0);
+
+    sim.run(2 * 60000);
+    CHECK(ConvertPrice(1000, 1) > 900 && ConvertPrice(1000, 1) < 940); // EUR.
+
+    // Then refreshed hourly.
+    uint64_t before = sim.stats().fxRequests;
+    sim.run(30 * 60000);
+    CHECK_EQ(sim.stats().fxRequests, before);
+}
+
+TEST(digitsFollowTheCardBrightnessAndTheDotIsLit)
+{
+    // A weekday without alerts: blue digits at the card's brightness (127), dimmed blue dot.
+    int brightest = 0;
+    for (int i = 0; i < layout::segmentPixelCount; i++)
+    {
+        PixelRef pixel = layout::segments.pixel[i];
+        const std::vector<uint8_t> &frame = sim.frame(stripPins[pixel.strip]);
+        for (int c = 0; c < 3 && pixel.index * 3 + c < (int)frame.size(); c++)
+        {
+            brightest = max(brightest, (int)frame[pixel.index * 3 + c]);
+        }
+    }
+    CHECK_EQ(brightest, 127);
+
+    int litDots = 0;
+    for (int i = 0; i < layout::dotCount; i++)
+    {
+        const std::vector<uint8_t> &frame = sim.frame(stripPins[layout::dots[i].strip]);
+        size_t at = layout::dots[i].index * 3;
+        litDots += at + 2 < frame.size() && frame[at + 2] == 0x30;
+    }
+    CHECK_EQ(litDots, 1);
+}
+
+TEST(spotRequestsStayWithinTheHourlyBudget)
+{
+    uint64_t before = sim.stats().spotRequests;
+    sim.run(3600000);
+
+    // 120 calls per hour on the card.
+    uint64_t calls = sim.stats().spotRequests - before;
+    CHECK(calls >= 100);
+    CHECK(calls <= 120);
+}
+
+TEST(spotConnectionIsKeptOpenBetweenFetches)
+{
+    uint64_t requests = sim.stats().spotRequests;
+    uint64_t connects = sim.stats().spotConnects;
+    sim.run(3600000);
+
+    CHECK(sim.stats().spotRequests - requests >= 100);
+    CHECK(sim.stats().spotConnects - connects <= 1);
+    CHECK_EQ(sim.stats().errors, 0u);
+}
+
+TEST(displayCyclesThroughInstrumentsAndCurrencies)
+{
+    bool seen[selectionCount] = {};
+    for (int i = 0; i < 100; i++)
+    {
+        sim.run(500);
+        int shown = displayedSelection();
+        if (shown >= 0)
+        {
+            seen[shown] = true;
+        }
+    }
+    for (int s = 0; s < selectionCount; s++)
+    {
+        CHECK(seen[s]);
+    }
+}
+
+TEST(buttonPressSelectsNextCurrency)
+{
+    // Right after an automatic change, so the next one is seconds away.
+    int shown = displayedSelection();
+    for (int i = 0; i < 100 && displayedSelection() == shown; i++)
+    {
+        sim.run(50);
+    }
+    sim.run(500);
+    shown = displayedSelection();
+    CHECK(shown >= 0);
+
+    // A quick press, possibly while the loop is blocked in a fetch.
+    after(100, "button 80");
+    sim.run(300);
+    CHECK_EQ(displayedSelection(), (shown + 1) % selectionCount);
+}
+
+TEST(wifiOutageStopsFetchingAndRecovers)
+{
+    after(1000, "wifi down");
+    after(10 * 60000, "wifi up");
+
+    sim.run(2 * 60000);
+    uint64_t before = sim.stats().spotRequests;
+    CHECK(WiFi.status() != WL_CONNECTED);
+
+    sim.run(7 * 60000);
+    CHECK_EQ(sim.stats().spotRequests, before);
+
+    sim.run(3 * 60000);
+    CHECK_EQ(WiFi.status(), WL_CONNECTED);
+    CHECK(sim.stats().spotRequests > before);
+}
+
+TEST(httpOutageIsRiddenOut)
+{
+    uint64_t failures = sim.stats().httpFailures;
+    after(1000, "http down");
+    after(5 * 60000, "http up");
+
+    sim.run(6 * 60000);
+    CHECK(sim.stats().httpFailures > failures);
+    CHECK_EQ(WiFi.status(), WL_CONNECTED);
+
+    // Fresh prices again after the outage.
+    uint64_t before = sim.stats().spotRequests;
+    sim.run(5 * 60000);
+    CHECK(sim.stats().spotRequests > before);
+    CHECK_EQ(sim.stats().errors, 0u);
+}
+
+TEST(priceJumpReachesTheDisplay)
+{
+    // +2.6% on the day's first price (1900), over the card's 1% rule, which lights solid green.
+    after(1000, "price XAU 1950");
+    sim.run(5 * 60000);
+
+    // Within one round of the 9 selections.
+    bool shown = false;
+    for (int i = 0; i < 200 && !shown; i++)
+    {
+        sim.run(250);
+        shown = displayedSelection() == 0 && sim.prices["XAU"] == 1950; // XAU in USD.
+    }
+    CHECK(shown);
+    CHECK_EQ(litSegmentColor(), 0x7f0000u); // GRB, green at the card's brightness.
+}
+
+TEST(heapIsStableOverAWeek)
+{
+    sim.run(3600000);
+    uint32_t settled = sim.stats().freeHeap;
+    unsigned long dropped = Log.dropped();
+
+    // Faster than 60 days per minute of wall time.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sim.run(7 * 86400000ull);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  7 days in %.1f s, %llu passes, worst pass %.1f ms, free heap %u (min %u)\n", seconds,
+           (unsigned long long)sim.stats().passes, sim.stats().worstPassMicros / 1000.0, sim.stats().freeHeap,
+           sim.stats().minFreeHeap);
+
+    CHECK(seconds < 7);
+    CHECK(sim.stats().freeHeap + 256 >= settled);
+    CHECK(sim.stats().minFreeHeap > 20000);
+    CHECK_EQ(Log.dropped(), dropped); // The health trace fits the log buffer.
+    CHECK_EQ(sim.stats().errors, 0u);
+}
+
+int main()
+{
+    return hostTest::run();
+}
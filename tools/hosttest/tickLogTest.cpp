@@ -0,0 +1,151 @@
+// Tick log tests: records name their instrument through the symbol table
+// of their own block, whatever the instrument configuration was.
+
+#include "hostTest.h"
+#include "tickLog.h"
+#include <string>
+
+const uint32_t monday = 19723 * tickLogSecondsPerDay; // 2024-01-01 00:00.
+
+static void clearCard()
+{
+    host::files.clear();
+}
+
+static size_t blockCount()
+{
+    return host::files["/ticks.bin"]->size() / tickLogBlockSize;
+}
+
+static TickBlockHeader header(size_t block)
+{
+    TickBlockHeader header;
+    memcpy(&header, host::files["/ticks.bin"]->data() + block * tickLogBlockSize, sizeof(header));
+    return header;
+}
+
+static TickSymbolTable symbols(size_t block)
+{
+    TickSymbolTable table;
+    memcpy(&table, host::files["/ticks.bin"]->data() + block * tickLogBlockSize + sizeof(TickBlockHeader), sizeof(table));
+    return table;
+}
+
+static TickRecord record(size_t block, int i)
+{
+    TickRecord record;
+    memcpy(&record, host::files["/ticks.bin"]->data() + block * tickLogBlockSize + tickLogRecordsOffset + i * sizeof(record),
+           sizeof(record));
+    return record;
+}
+
+// Symbol of a record, as the decoder reads it.
+static std::string symbolOf(size_t block, int i)
+{
+    TickSymbolTable table = symbols(block);
+    TickRecord r = record(block, i);
+    return r.symbol < table.count ? std::string(table.symbols[r.symbol], strnlen(table.symbols[r.symbol], tickLogSymbolSize)) : "?";
+}
+
+TEST(recordsNameTheirSymbolAndSource)
+{
+    clearCard();
+    tickLog log("/ticks.bin", "/ticks.idx");
+    CHECK(log.begin());
+
+    CHECK(log.append(monday + 10, "XAU", 2050.5f));
+    CHECK(log.append(monday + 11, "XAG", 23.25f, tickLogSourceStream));
+    CHECK(log.append(monday + 12, "XAU", 2051.0f, tickLogSourceShare));
+    CHECK(log.flush());
+
+    CHECK_EQ(blockCount(), 1u);
+    CHECK_EQ(header(0).version, 2);
+    CHECK_EQ(header(0).count, 3);
+    CHECK_EQ(symbols(0).count, 2);
+
+    CHECK(symbolOf(0, 0) == "XAU");
+    CHECK(symbolOf(0, 1) == "XAG");
+    CHECK(symbolOf(0, 2) == "XAU");
+    CHECK_EQ(record(0, 0).flags, tickLogSourcePoll);
+    CHECK_EQ(record(0, 1).flags, tickLogSourceStream);
+    CHECK_EQ(record(0, 2).flags, tickLogSourceShare);
+    CHECK_EQ(record(0, 1).price, 232500);
+}
+
+TEST(reorderedInstrumentsKeepTheirSymbols)
+{
+    clearCard();
+    {
+        tickLog log("/ticks.bin", "/ticks.idx");
+        CHECK(log.begin());
+        CHECK(log.append(monday + 10, "XAU", 2050));
+        CHECK(log.flush());
+    }
+
+    // Restarted with XAG as the first instrument.
+    tickLog log("/ticks.bin", "/ticks.idx");
+    CHECK(log.begin());
+    CHECK(log.append(monday + 20, "XAG", 23));
+    CHECK(log.append(monday + 21, "XAU", 2051));
+    CHECK(log.flush());
+
+    CHECK_EQ(blockCount(), 2u);
+    CHECK(symbolOf(0, 0) == "XAU");
+    CHECK(symbolOf(1, 0) == "XAG");
+    CHECK(symbolOf(1, 1) == "XAU");
+}
+
+TEST(fullSymbolTableStartsANewBlock)
+{
+    clearCard();
+    tickLog log("/ticks.bin", "/ticks.idx");
+    CHECK(log.begin());
+
+    for (int i = 0; i <= tickLogMaxSymbols; i++)
+    {
+        CHECK(log.append(monday + i, ("S" + std::to_string(i)).c_str(), i));
+    }
+    CHECK(log.flush());
+
+    CHECK_EQ(blockCount(), 2u);
+    CHECK_EQ(header(0).count, tickLogMaxSymbols);
+    CHECK_EQ(symbols(0).count, tickLogMaxSymbols);
+    CHECK_EQ(header(1).count, 1);
+    CHECK(symbolOf(1, 0) == "S8");
+}
+
+TEST(fullBlockAndNewDayStartNewBlocks)
+{
+    clearCard();
+    tickLog log("/ticks.bin", "/ticks.idx");
+    CHECK(log.begin());
+
+    for (int i = 0; i < tickLogRecordsPerBlock + 1; i++)
+    {
+        CHECK(log.append(monday + i, "XAU", 2000 + i));
+    }
+    CHECK(log.append(monday + tickLogSecondsPerDay, "XAU", 2100));
+    CHECK(log.flush());
+
+    CHECK_EQ(blockCount(), 3u);
+    CHECK_EQ(header(0).count, tickLogRecordsPerBlock);
+    CHECK_EQ(header(1).count, 1);
+    CHECK_EQ(header(2).baseTime, monday + tickLogSecondsPerDay);
+    CHECK(symbolOf(2, 0) == "XAU");
+}
+
+TEST(rejectsSymbolsThatDoNotFit)
+{
+    clearCard();
+    tickLog log("/ticks.bin", "/ticks.idx");
+    CHECK(log.begin());
+
+    CHECK(!log.append(monday, "", 1));
+    CHECK(!log.append(monday, "TOOLONGX", 1));
+    CHECK(log.append(monday, "LONGEST", 1));
+}
+
+int main()
+{
+    return hostTest::run();
+}
@@ -0,0 +1,181 @@
+// Wi-Fi connector tests: the connection state machine against the
+// simulated access points of the shim, with reboots that keep RTC memory.
+
+#include "hostTest.h"
+#include "wifiConnector.h"
+#include <memory>
+
+const IPAddress homeAddress(192, 168, 1, 50);
+const IPAddress homeGateway(192, 168, 1, 1);
+
+// Two access points, nothing cached, Wi-Fi off.
+static void powerOn()
+{
+    host::setMillis(0);
+    memset(ESP.rtcMemory, 0, sizeof(ESP.rtcMemory));
+    host::networks.clear();
+    host::networks.push_back({"Home", "secret", {2, 0, 0, 0, 0, 1}, 6, true, 3000, 800, 500, homeAddress, homeGateway});
+    host::networks.push_back({"Backup", "other", {2, 0, 0, 0, 0, 2}, 11, true, 3000, 800, 500,
+                              IPAddress(10, 0, 1, 20), IPAddress(10, 0, 1, 1)});
+    host::wifiBegins.clear();
+    WiFi.disconnect();
+}
+
+// A fresh connector as after a reset, RTC memory is kept.
+static wifiConnector &reboot()
+{
+    static std::unique_ptr<wifiConnector> wifi;
+    WiFi.disconnect();
+    host::wifiBegins.clear();
+
+    wifi.reset(new wifiConnector());
+    wifi->addNetwork("Home", "secret");
+    wifi->addNetwork("Backup", "other");
+    wifi->begin();
+    return *wifi;
+}
+
+// Update every 50 ms, returns true once connected.
+static bool connect(wifiConnector &wifi, uint32_t timeoutMillis = 30000)
+{
+    for (uint32_t waited = 0; waited < timeoutMillis; waited += 50)
+    {
+        if (wifi.update())
+        {
+            return true;
+        }
+        host::advanceMillis(50);
+    }
+    return false;
+}
+
+TEST(firstConnectScansAndLeasesAnAddress)
+{
+    powerOn();
+    wifiConnector &wifi = reboot();
+    CHECK(connect(wifi));
+
+    CHECK_EQ(host::wifiBegins.size(), 1u);
+    CHECK(!host::wifiBegins[0].bssid && !host::wifiBegins[0].staticAddress);
+    CHECK(WiFi.localIP() == homeAddress);
+    CHECK_EQ(wifi.stats().fullConnects, 1u);
+    CHECK_EQ(wifi.stats().histogram[3], 1u); // 3.5 s.
+}
+
+TEST(rebootReconnectsFastFromTheCache)
+{
+    powerOn();
+    CHECK(connect(reboot()));
+
+    wifiConnector &wifi = reboot();
+    CHECK(connect(wifi));
+    CHECK_EQ(host::wifiBegins.size(), 1u);
+    CHECK(host::wifiBegins[0].bssid && host::wifiBegins[0].channel == 6 && host::wifiBegins[0].staticAddress);
+    CHECK(WiFi.localIP() == homeAddress);
+    CHECK_EQ(wifi.stats().fastConnects, 1u);
+    CHECK_EQ(wifi.stats().lastConnectMillis, 800u);
+}
+
+TEST(failingNetworkFallsBackToTheNext)
+{
+    powerOn();
+    host::networks[0].up = false;
+
+    wifiConnector &wifi = reboot();
+    CHECK(connect(wifi));
+    CHECK(strcmp(wifi.ssid(), "Backup") == 0);
+    CHECK_EQ(wifi.stats().failedAttempts, 1u);
+
+    // The fallback is cached.
+    host::networks[0].up = true;
+    wifiConnector &rebooted = reboot();
+    CHECK(connect(rebooted));
+    CHECK(strcmp(rebooted.ssid(), "Backup") == 0);
+    CHECK_EQ(rebooted.stats().fastConnects, 1u);
+}
+
+TEST(failedRoundsBackOff)
+{
+    powerOn();
+    host::networks[0].up = false;
+    host::networks[1].up = false;
+
+    wifiConnector &wifi = reboot();
+    CHECK(!connect(wifi, 7000));
+    CHECK(wifi.state() == WifiState::Backoff);
+    size_t begins = host::wifiBegins.size();
+
+    // Next round after the 5 s backoff.
+    host::advanceMillis(5100);
+    wifi.update();
+    CHECK_EQ(host::wifiBegins.size(), begins + 1);
+
+    host::networks[1].up = true;
+    CHECK(connect(wifi));
+    CHECK(strcmp(wifi.ssid(), "Backup") == 0);
+}
+
+TEST(failedFastAttemptDropsTheCacheOverAReset)
+{
+    powerOn();
+    CHECK(connect(reboot()));
+
+    // The access point is replaced, the cached BSSID is gone.
+    host::networks[0].bssid[5] = 9;
+    host::networks[1].up = false;
+    wifiConnector &wifi = reboot();
+    CHECK(!connect(wifi, 4000));
+    CHECK(host::wifiBegins[0].bssid);
+
+    // Reset before the round completes: no second try of the cached access point.
+    wifiConnector &rebooted = reboot();
+    CHECK(connect(rebooted));
+    CHECK(!host::wifiBegins[0].bssid && !host::wifiBegins[0].staticAddress);
+    CHECK_EQ(rebooted.stats().fullConnects, 1u);
+}
+
+TEST(leaseIsRenewedEveryFewFastConnects)
+{
+    powerOn();
+    CHECK(connect(reboot()));
+
+    for (int i = 0; i < WIFI_LEASE_CHECK_EVERY; i++)
+    {
+        wifiConnector &wifi = reboot();
+        CHECK(connect(wifi));
+        CHECK(host::wifiBegins[0].staticAddress);
+    }
+
+    // The router handed the address to another device meanwhile.
+    const IPAddress leased(192, 168, 1, 77);
+    host::networks[0].address = leased;
+
+    wifiConnector &wifi = reboot();
+    CHECK(connect(wifi));
+    CHECK(host::wifiBegins[0].bssid && !host::wifiBegins[0].staticAddress);
+    CHECK(WiFi.localIP() == leased);
+    CHECK_EQ(wifi.stats().leaseChanges, 1u);
+
+    // Fast again, with the new address.
+    CHECK(connect(reboot()));
+    CHECK(host::wifiBegins[0].staticAddress);
+    CHECK(WiFi.localIP() == leased);
+}
+
+TEST(droppedConnectionReconnects)
+{
+    powerOn();
+    wifiConnector &wifi = reboot();
+    CHECK(connect(wifi));
+
+    host::dropWifi();
+    CHECK(!wifi.update());
+    CHECK(connect(wifi));
+    CHECK_EQ(wifi.stats().fastConnects, 1u);
+    CHECK_EQ(wifi.stats().fullConnects, 1u);
+}
+
+int main()
+{
+    return hostTest::run();
+}
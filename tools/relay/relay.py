@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+	Synthetic quote relay
+
+	Serves random-walk ticks as Server-Sent Events in the format read by the
+	Spot Clock quote stream (firmware/include/quoteStream.h), for testing the
+	stream without a live feed.
+
+	Usage:
+		relay.py [--port 8080] [--path /ticks] [--symbols XAU,XAG,XPT] [--interval 1.0]
+
+	SD card (wifi.txt) settings for the clock:
+		"stream host": "<this machine's address>", "stream port": "8080", "stream path": "/ticks"
+
+	Latency: each tick carries its send time (milliseconds on the relay's
+	monotonic clock). The clock learns the offset between the two clocks from
+	the fastest tick and reports end-to-end latency (send to display updated,
+	including time spent waiting in its socket buffer) in its health trace,
+	next to read-to-pixel latency. The relay prints the time spent in write()
+	per client, which only shows a stalled connection.
+"""
+
+import argparse
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+START_PRICES = {"XAU": 1920.0, "XAG": 23.5, "XPT": 910.0, "XPD": 1250.0}
+
+
+class Market:
+    """Shared random walk, every client sees the same prices."""
+
+    def __init__(self, symbols):
+        self.lock = threading.Lock()
+        self.open = {s: START_PRICES.get(s, 100.0) for s in symbols}
+        self.close = dict(self.open)
+
+    def tick(self):
+        with self.lock:
+            symbol = random.choice(list(self.close))
+            self.close[symbol] *= 1 + random.gauss(0, 0.0005)
+            return symbol, self.close[symbol], self.open[symbol]
+
+
+def make_handler(market, path, interval):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def do_GET(self):
+            if self.path != path:
+                self.send_error(404)
+                return
+
+            self.send_response(200)
+            self.send_header("Content-Type", "text/event-stream")
+            self.send_header("Cache-Control", "no-cache")
+            self.send_header("Connection", "keep-alive")
+            self.end_headers()
+
+            client = "%s:%d" % self.client_address
+            print("%s connected" % client, flush=True)
+            count = 0
+            total = 0.0
+            worst = 0.0
+
+            try:
+                while True:
+                    symbol, close, open_ = market.tick()
+                    generated = time.perf_counter()
+                    sent = int(time.monotonic() * 1000) & 0xFFFFFFFF
+                    self.wfile.write(b"data: %s %.2f %.2f %d\n\n" % (symbol.encode(), close, open_, sent))
+                    self.wfile.flush()
+                    latency = (time.perf_counter() - generated) * 1000
+
+                    count += 1
+                    total += latency
+                    worst = max(worst, latency)
+                    if count % 60 == 0:
+                        print("%s %d ticks, write() mean %.3f ms, max %.3f ms" % (client, count, total / count, worst), flush=True)
+
+                    time.sleep(interval)
+            except (BrokenPipeError, ConnectionResetError):
+                print("%s disconnected after %d ticks" % (client, count), flush=True)
+
+        def log_message(self, format, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Synthetic SSE quote relay.")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--path", default="/ticks")
+    parser.add_argument("--symbols", default="XAU,XAG,XPT", help="Comma separated, symbols not listed are never sent.")
+    parser.add_argument("--interval", type=float, default=1.0, help="Seconds between ticks.")
+    args = parser.parse_args()
+
+    market = Market(args.symbols.split(","))
+    server = ThreadingHTTPServer(("", args.port), make_handler(market, args.path, args.interval))
+    print("Relay on port %d, path %s, symbols %s" % (args.port, args.path, args.symbols), flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,178 @@
+/*
+	Tick log decoder
+
+	Decodes the binary quote log written by the Spot Clock firmware
+	(ticks.bin and ticks.idx copied from the SD card) and exports it as CSV.
+
+	Build:
+		g++ -std=c++17 -O2 -I../../firmware/include ticklog.cpp -o ticklog
+
+	Usage:
+		ticklog <log directory>                 Export all records.
+		ticklog <log directory> <from> [<to>]   Export days from..to (YYYY-MM-DD).
+
+	Output columns: time (local, clock time zone), instrument, price, source
+	(poll, stream or share). Instruments come from each block's symbol table,
+	records of version 1 blocks show the instrument index as "#<n>".
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "tickLogFormat.h"
+
+static bool ParseDay(const char *text, uint32_t *day)
+{
+    int y, m, d;
+    if (sscanf(text, "%d-%d-%d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31)
+    {
+        fprintf(stderr, "Invalid date: %s\n", text);
+        return false;
+    }
+    *day = DaysFromCivil(y, m, d);
+    return true;
+}
+
+// Returns the first block of the first day in [fromDay, toDay] with data, -1 if none.
+static long FindStartBlock(const std::string &indexPath, uint32_t fromDay, uint32_t toDay)
+{
+    FILE *file = fopen(indexPath.c_str(), "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Cannot open index: %s\n", indexPath.c_str());
+        return -1;
+    }
+
+    TickIndexHeader header;
+    long block = -1;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != tickLogIndexMagic)
+    {
+        fprintf(stderr, "Invalid index: %s\n", indexPath.c_str());
+    }
+    else
+    {
+        uint32_t day = fromDay < header.firstDay ? header.firstDay : fromDay;
+        uint32_t entry;
+
+        // O(1) seek to the requested day, then skip days without data.
+        fseek(file, sizeof(header) + (long)(day - header.firstDay) * sizeof(entry), SEEK_SET);
+        for (; day <= toDay && fread(&entry, sizeof(entry), 1, file) == 1; day++)
+        {
+            if (entry != 0)
+            {
+                block = entry - 1;
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+    return block;
+}
+
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+
+    if (arg >= argc)
+    {
+        fprintf(stderr, "Usage: %s <log directory> [<from YYYY-MM-DD> [<to YYYY-MM-DD>]]\n", argv[0]);
+        return 1;
+    }
+
+    std::string directory = argv[arg++];
+    uint32_t fromDay = 0;
+    uint32_t toDay = UINT32_MAX;
+    long block = 0;
+
+    if (arg < argc)
+    {
+        if (!ParseDay(argv[arg], &fromDay))
+        {
+            return 1;
+        }
+        toDay = fromDay;
+
+        if (arg + 1 < argc && !ParseDay(argv[arg + 1], &toDay))
+        {
+            return 1;
+        }
+
+        block = FindStartBlock(directory + "/ticks.idx", fromDay, toDay);
+        if (block < 0)
+        {
+            return 0;
+        }
+    }
+
+    FILE *file = fopen((directory + "/ticks.bin").c_str(), "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Cannot open log: %s/ticks.bin\n", directory.c_str());
+        return 1;
+    }
+
+    fseek(file, block * tickLogBlockSize, SEEK_SET);
+
+    printf("time,instrument,price,source\n");
+
+    uint8_t bytes[tickLogBlockSize];
+    while (fread(bytes, tickLogBlockSize, 1, file) == 1)
+    {
+        TickBlockHeader header;
+        memcpy(&header, bytes, sizeof(header));
+
+        TickSymbolTable table = {};
+        uint16_t recordsOffset = tickLogRecordsOffsetV1;
+        uint8_t maxRecords = tickLogRecordsPerBlockV1;
+
+        if (header.version >= 2)
+        {
+            memcpy(&table, bytes + sizeof(header), sizeof(table));
+            recordsOffset = tickLogRecordsOffset;
+            maxRecords = tickLogRecordsPerBlock;
+        }
+
+        // Skip unused or damaged blocks.
+        if (header.magic != tickLogBlockMagic || header.count > maxRecords || table.count > tickLogMaxSymbols)
+        {
+            continue;
+        }
+
+        uint32_t day = header.baseTime / tickLogSecondsPerDay;
+        if (day < fromDay)
+        {
+            continue;
+        }
+        if (day > toDay)
+        {
+            break;
+        }
+
+        for (int i = 0; i < header.count; i++)
+        {
+            TickRecord record;
+            memcpy(&record, bytes + recordsOffset + i * sizeof(record), sizeof(record));
+
+            uint32_t time = header.baseTime + record.deltaSeconds;
+            int year, month, dayOfMonth;
+            CivilFromDays(time / tickLogSecondsPerDay, &year, &month, &dayOfMonth);
+            uint32_t seconds = time % tickLogSecondsPerDay;
+
+            std::string symbol = record.symbol < table.count
+                                     ? std::string(table.symbols[record.symbol], strnlen(table.symbols[record.symbol], tickLogSymbolSize))
+                                     : "#" + std::to_string(record.symbol);
+
+            static const char *sources[] = {"poll", "stream", "share", "unknown"};
+
+            printf("%04d-%02d-%02d %02u:%02u:%02u,%s,%.4f,%s\n", year, month, dayOfMonth,
+                   seconds / 3600, (seconds / 60) % 60, seconds % 60,
+                   symbol.c_str(), (double)record.price / tickLogPriceScale, sources[record.flags & tickLogSourceMask]);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}